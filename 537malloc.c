@@ -3,279 +3,1579 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <math.h>
+#include <pthread.h>
 #include "range_tree.h"
+#include "shard_index.h"
+#include "shadow.h"
+#include "arena.h"
+#include "epoch.h"
+#include "redzone.h"
+#include "quarantine.h"
+#include "poison.h"
+#include "site_table.h"
+#include "stack_depot.h"
+#include "sampler.h"
+#include "stats.h"
+#include "size_hist.h"
+#include "pool.h"
+#include "ptr_hash.h"
 #include "537malloc.h"
 
-//Tree to hold allocations for main program functionality 
-static tree *tree_main;
+//Index to hold allocations for main program functionality, a tree per
+//address shard so threads can track blocks at the same time
+//With the arena allocator it is an optional secondary index
+static shard_index *index_main;
 
-//Variables used to keep track of orgin address allocations for extra credit
-static addr_node* addr_arr[BUFF_SIZE];
-static int arr_index = 0;
+//Set by the first allocation, which fixes the allocator and the index
+static int initialized = 0;
+static pthread_once_t setup_once = PTHREAD_ONCE_INIT;
 
-//Extra Credit- This function adds an origin address to the list
-void add_addr(void* address, size_t size)
+//Nonzero when blocks come from the built in arenas (arena.c) instead of
+//libc, and whether the allocator was chosen by malloc537_allocator()
+static int use_arena = 0;
+static int allocator_chosen = 0;
+
+//Nonzero when libc blocks are padded with canary filled redzones
+//(redzone.c), and whether that was chosen by malloc537_redzones()
+static int use_redzones = 0;
+static int redzones_chosen = 0;
+
+//Frames of the allocating call stack credited with each allocation
+static int stack_depth = STACK_DEFAULT_DEPTH;
+
+//Sites printed by the leak report run at exit, if one was asked for
+static size_t leak_top = LEAK_REPORT_TOP;
+
+//Whether the sampling interval was set by malloc537_sample_interval()
+static int sample_chosen = 0;
+
+//Whether the quarantine budget was set by malloc537_quarantine()
+static int quarantine_chosen = 0;
+
+//Nonzero when fresh blocks are filled with POISON_FRESH and freed ones
+//with QUARANTINE_POISON, and whether that was chosen by malloc537_fill()
+static int use_fill = 0;
+static int fill_chosen = 0;
+
+//Bounded history of recently freed addresses, used to tell a double
+//free apart from a pointer that was never allocated
+static void *freed_hist[FREE_HISTORY_SIZE];
+static unsigned int freed_index = 0;
+
+//Frees blocks leaving the quarantine, defined with the other release
+//functions below
+static void quarantine_evict(void *ptr, size_t length);
+
+//Extra Credit- This function credits count allocations totalling size
+//bytes to the call stack of the allocating function whose frame address is
+//frame. Stacks are interned in the stack depot (stack_depot.c) and each
+//distinct stack has a site in a hash table (site_table.c)
+//Return the site, or NULL if out of memory for a new one
+site *add_addr(void* frame, size_t size, int count)
 {
-	int found = 0;
-	
-	//Update an existing origin array if found
-	for(int i = 0; i < arr_index; i++)
-	{
-		if(addr_arr[i]->addr == address)
-		{
-			found = 1;
-			addr_arr[i]->allocated_bytes = addr_arr[i]->allocated_bytes + size;
-			addr_arr[i]->num_allocations++;
-			break;
+	void *frames[STACK_MAX_DEPTH];
+	int depth = stack_unwind(frame, frames, stack_depth);
+	site *entry = site_get(depot_put(frames, depth));
 
-		}
+	//Out of memory for a new origin, the allocations go uncounted
+	if(entry == NULL)
+	{
+		return NULL;
 	}
 
-	//If this is a new origin address, add it to the array
-	if(!found)
+	__atomic_fetch_add(&entry->allocated_bytes, size, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&entry->num_allocations, count, __ATOMIC_RELAXED);
+
+	return entry;
+}
+
+//Order sites by bytes allocated, most first
+static int site_cmp(const void *p1, const void *p2)
+{
+	size_t bytes1 = __atomic_load_n(&(*(site * const *)p1)->allocated_bytes, __ATOMIC_RELAXED);
+	size_t bytes2 = __atomic_load_n(&(*(site * const *)p2)->allocated_bytes, __ATOMIC_RELAXED);
+
+	return (bytes1 < bytes2) - (bytes1 > bytes2);
+}
+
+//Credit count blocks totalling size bytes to the call stack of the
+//allocating function whose frame address is frame, if the sampler picks
+//them, and set weight to the number of allocations they stand for. Only
+//called once SAMPLE_SKIP has let the allocation through
+//Return the site credited, or NULL if the blocks were not sampled
+static site *profile_alloc(void *frame, size_t size, int count, double *weight)
+{
+	if(!sample_take(size, weight))
 	{
-		addr_arr[arr_index] = malloc(sizeof(addr_node));
-		addr_arr[arr_index]->addr = address;
-		addr_arr[arr_index]->allocated_bytes = size;
-		addr_arr[arr_index]->num_allocations = 1;
-		arr_index++;
+		return NULL;
 	}
 
+	return add_addr(frame, (size_t)(size * *weight + 0.5), (int)(count * *weight + 0.5));
 }
 
+//Count a request for size bytes in the size histograms: every request's,
+//and that of origin, the site it was credited to, if any. A site's request
+//stands for weight requests, as many as the sampled allocation it was part
+//of, so the site's sizes are weighted like its other counts
+static void size_record(size_t size, site *origin, double weight)
+{
+	size_hist_add(size_hist_all(), size, 1);
+
+	if(origin != NULL)
+	{
+		size_hist_add(&origin->sizes, size, (size_t)(weight + 0.5));
+	}
+}
+
+//Print the p50, p90 and p99 of the sizes in hist, as upper bounds
+static void print_percentiles(const size_hist *hist)
+{
+	printf("p50 <= %zu, p90 <= %zu, p99 <= %zu bytes", size_hist_percentile(hist, 50), size_hist_percentile(hist, 90), size_hist_percentile(hist, 99));
+}
 
 //Extra Credit- This function prints all origin addresses, the number of times that the origin address
-//was called, and the total allocation by the origin address
+//was called, and the total allocation by the origin address, largest total first
+//Each origin is followed by the rest of its call stack. With sampling on,
+//the counts and totals are estimates built from the sampled allocations
 void view_allocations()
 {
-	for(int i = 0; i < arr_index; i++)
+	size_t n;
+	site **sites = site_snapshot(&n);
+	void *const *frames;
+	int depth;
+
+	if(sites == NULL)
 	{
-		printf("The instruction at address: %p called malloc537 %d times to allocate a total of %ld bytes of memory\n", addr_arr[i]->addr, addr_arr[i]->num_allocations, addr_arr[i]->allocated_bytes);
+		fprintf(stderr, "Malloc failed");
+		exit(EXIT_FAILURE);
 	}
-	
-}
 
-void *malloc537(size_t size)
-{
+	qsort(sites, n, sizeof(site *), site_cmp);
 
-	// int test_sp = 0;
-	// for(int i = 0; i < 48; i=i+4){
-	// 	printf("Address of tp: %p offset: %d\n", (char*)*((&test_sp)-i), i );
-	// }
-	// printf("\n\n");
-	
-	volatile long testarr[2];
-	long sneak[1];
-	testarr[1] = 12;
-	if(testarr[1])
+	for(size_t i = 0; i < n; i++)
 	{
+		frames = depot_get(sites[i]->stack, &depth);
+
+		printf("The instruction at address: %p called malloc537 %zu times to allocate a total of %zu bytes of memory\n", depth > 0 ? frames[0] : NULL, __atomic_load_n(&sites[i]->num_allocations, __ATOMIC_RELAXED), __atomic_load_n(&sites[i]->allocated_bytes, __ATOMIC_RELAXED));
+
+		for(int j = 1; j < depth; j++)
+		{
+			printf("\tcalled from %p\n", frames[j]);
+		}
 
+		printf("\tRequest sizes: ");
+		print_percentiles(&sites[i]->sizes);
+		printf("\n");
+
+		//Live counts are kept for sampled blocks only, so they are exact
+		//only when every allocation is recorded
+		if(sample_interval() == 0 && __atomic_load_n(&sites[i]->live_blocks, __ATOMIC_RELAXED) > 0)
+		{
+			printf("\t%zu bytes in %zu blocks still allocated\n", __atomic_load_n(&sites[i]->live_bytes, __ATOMIC_RELAXED), __atomic_load_n(&sites[i]->live_blocks, __ATOMIC_RELAXED));
+		}
 	}
 
-    //feel free to adjust the search limits
-    for( int i = -32; i <= 32; ++i) {
-        printf("offset %3d: data 0x%08X\n", i, sneak[i]);
-		//printf("Address form: %p\n", (char*)sneak[i]);
-    }
+	site_snapshot_free(sites);
+}
 
-	if(size == 0) {
-		fprintf(stderr, "Warning: Allocating memory of size 0\n");
+//Print how many requests to malloc537, malloc537_batch and realloc537 asked
+//for each range of sizes, with percentiles. Each power of two is split
+//into four ranges
+void view_sizes()
+{
+	const size_hist *hist = size_hist_all();
+	size_t total = size_hist_total(hist);
+
+	printf("%zu allocation requests: ", total);
+	print_percentiles(hist);
+	printf(", p99.9 <= %zu bytes\n", size_hist_percentile(hist, 99.9));
+
+	for(int i = 0; i < SIZE_HIST_BUCKETS; i++)
+	{
+		size_t count = __atomic_load_n(&hist->counts[i], __ATOMIC_RELAXED);
+
+		if(count == 0)
+		{
+			continue;
+		}
+
+		if(size_hist_lower(i) == size_hist_upper(i))
+		{
+			printf("\t%zu bytes: %zu (%.1f%%)\n", size_hist_lower(i), count, 100.0 * count / total);
+		}
+		else
+		{
+			printf("\t%zu-%zu bytes: %zu (%.1f%%)\n", size_hist_lower(i), size_hist_upper(i), count, 100.0 * count / total);
+		}
 	}
+}
 
-	//If this is the first malloc, create the tree
-	if(tree_main == NULL)
+//Copy the counts of up to n size ranges, smallest first, into counts,
+//and the smallest size of each range into lower, if it is not NULL
+//Return the number of ranges there are
+size_t malloc537_size_histogram(size_t *counts, size_t *lower, size_t n)
+{
+	for(size_t i = 0; i < n && i < SIZE_HIST_BUCKETS; i++)
 	{
-		tree_main = tree_create();
+		counts[i] = __atomic_load_n(&size_hist_all()->counts[i], __ATOMIC_RELAXED);
+		if(lower != NULL)
+		{
+			lower[i] = size_hist_lower((int)i);
+		}
 	}
 
-	void* retVal = malloc(size);
-	if(retVal == NULL)
+	return SIZE_HIST_BUCKETS;
+}
+
+//Return a size at least pct percent of the requests asked for no more
+//than, to within a quarter, or 0 if there were none
+size_t malloc537_size_percentile(double pct)
+{
+	return size_hist_percentile(size_hist_all(), pct);
+}
+
+//Record a freed address in the bounded recent-free history, overwriting
+//the oldest entry once the history is full
+static void history_add(void *ptr)
+{
+	unsigned int index = __atomic_fetch_add(&freed_index, 1, __ATOMIC_RELAXED) % FREE_HISTORY_SIZE;
+
+	__atomic_store_n(&freed_hist[index], ptr, __ATOMIC_RELAXED);
+}
+
+//Return 1 if the address is in the recent-free history, 0 otherwise
+//Only consulted once a pointer is known not to be live
+static int history_find(void *ptr)
+{
+	for(int i = 0; i < FREE_HISTORY_SIZE; i++)
 	{
-		fprintf(stderr, "Malloc failed");
-		exit(EXIT_FAILURE);
+		if(__atomic_load_n(&freed_hist[i], __ATOMIC_RELAXED) == ptr && ptr != NULL)
+		{
+			return 1;
+		}
 	}
 
-	//Previous node in tree to the newly allocated memory
-	node *prevPtr = tree_find_GLT(tree_main, retVal);
+	return 0;
+}
+
+//Order two addresses for qsort
+static int addr_cmp(const void *p1, const void *p2)
+{
+	uintptr_t addr1 = (uintptr_t)*(void * const *)p1;
+	uintptr_t addr2 = (uintptr_t)*(void * const *)p2;
+
+	return (addr1 > addr2) - (addr1 < addr2);
+}
 
-	//Previous node to end of tree, indicating a node exists in the middle
-	//of the potentially allocated memory
-	node *containPtr = tree_find_GLT(tree_main, (retVal + size));
+//Print the leak report asked for through MALLOC537_LEAK_REPORT
+static void leak_report_at_exit()
+{
+	malloc537_leak_report(leak_top);
+}
 
+//Choose the allocator and create the tree on the first allocation
+//With the arena allocator the tree is only built if an index was named
+//through MALLOC537_INDEX or malloc537_init()
+static void setup_run()
+{
+	const char *name = getenv(ALLOCATOR_ENV);
 
-	//Potentially Split Node
+	initialized = 1;
 
-	//If the node previous to the potential node is free and is overlapping
-	//The space of the potential node, then split the node
-	if(prevPtr != NULL)
+	if(!allocator_chosen && name != NULL)
 	{
-		if((prevPtr->free_flag == 1) && ((prevPtr->addr + prevPtr->length) > retVal))
+		if(strcmp(name, "arena") == 0)
 		{
-			//Reduce length of free node to be new (pointer - previous pointer)
-			prevPtr->length = (retVal - prevPtr->addr);
+			use_arena = 1;
+		}
+		else if(strcmp(name, "libc") != 0)
+		{
+			fprintf(stderr, "Warning: Unknown allocator %s, using libc\n", name);
+		}
+	}
+
+	name = getenv(REDZONE_ENV);
+	if(!redzones_chosen && name != NULL)
+	{
+		use_redzones = (strcmp(name, "0") != 0);
+	}
+
+	//Arena blocks are found by their start, which redzones would move
+	if(use_redzones && use_arena)
+	{
+		fprintf(stderr, "Warning: Redzones are not supported by the arena allocator\n");
+		use_redzones = 0;
+	}
 
-		}		
+	name = getenv(STACK_DEPTH_ENV);
+	if(name != NULL)
+	{
+		stack_depth = atoi(name);
+		if(stack_depth < 1)
+		{
+			stack_depth = 1;
+		}
+		else if(stack_depth > STACK_MAX_DEPTH)
+		{
+			stack_depth = STACK_MAX_DEPTH;
+		}
 	}
-	
-	//Else if the range of the potential node includes the start of a an existing free node
-	else if(containPtr != NULL)
+
+	name = getenv(LEAK_REPORT_ENV);
+	if(name != NULL)
 	{
-		if((retVal < containPtr->addr) && (containPtr->free_flag == 1))
+		if(name[0] != '\0')
 		{
-			//Delete the free node from the tree
-			tree_erase(tree_main, prevPtr->addr);
+			leak_top = strtoul(name, NULL, 10);
 		}
+		atexit(leak_report_at_exit);
 	}
 
-	//Add the allocation to the tree
-	node_insert(tree_main, retVal, size);
+	name = getenv(SAMPLE_INTERVAL_ENV);
+	if(name != NULL && !sample_chosen)
+	{
+		sample_set_interval(strtoull(name, NULL, 10));
+	}
 
-	// printf("offset %3d: data 0x%08X\n", 3, sneak[3 + sizeof(testarr[1])]);
-	// printf("Address form: %p\n", (char*)sneak[]);
+	name = getenv(POISON_FILL_ENV);
+	if(!fill_chosen && name != NULL)
+	{
+		use_fill = (strcmp(name, "0") != 0);
+	}
 
-	//Add the origin address and allocation size to the list
-	add_addr(__builtin_return_address(0), size);
-	
-	//USE THIS TO INSERT
-	//add_addr((char*)sneak[3], size);
+	name = getenv(QUARANTINE_ENV);
+	if(!quarantine_chosen && name != NULL)
+	{
+		quarantine_set_budget(strtoull(name, NULL, 10), quarantine_evict);
+	}
 
-	return retVal;
+	//A quarantined arena block would still be found live by its header
+	if(quarantine_budget() > 0 && use_arena)
+	{
+		fprintf(stderr, "Warning: The quarantine is not supported by the arena allocator\n");
+		quarantine_set_budget(0, quarantine_evict);
+	}
+
+	if(index_main == NULL && (!use_arena || getenv(TREE_BACKEND_ENV) != NULL))
+	{
+		index_main = shard_create();
+	}
 }
 
-void free537(void *ptr) {
+//Run setup_run once, however many threads make their first allocation
+static void setup()
+{
+	pthread_once(&setup_once, setup_run);
+}
 
-	if (ptr == NULL) {
-		fprintf(stderr, "Null pointer err\n");
-		exit(EXIT_FAILURE);
+//Return the record of the live block starting at ptr, or NULL if there is
+//none. Arena blocks are answered by their header
+static node *find_block(void *ptr)
+{
+	if(use_arena)
+	{
+		return arena_find(ptr);
 	}
 
-	//check if ptr points to the first byte 
-	// or memory not allocated by 537malloc()
-	if (tree_find(tree_main,ptr) == NULL) {
-		fprintf(stderr, "Mem not alocated by 537malloc() or bad pointer\n");
-		exit(EXIT_FAILURE);
+	return (index_main == NULL) ? NULL : shard_find(index_main, ptr);
+}
+
+//Return the record of the live block with the greatest start below ptr,
+//or NULL if there is none
+static node *find_block_GLT(void *ptr)
+{
+	if(index_main != NULL)
+	{
+		return shard_find_GLT(index_main, ptr);
 	}
 
-	if (node_isfree(tree_main,ptr)) {
-		fprintf(stderr, "Node has already been freed\n");
-		exit(EXIT_FAILURE);
+	return use_arena ? arena_find_GLT(ptr) : NULL;
+}
+
+//Visit the live blocks in address order from the first one that does not
+//start below from, until visit returns nonzero
+static void walk_blocks(void *from, tree_visit_f visit, void *arg)
+{
+	if(index_main != NULL)
+	{
+		shard_walk(index_main, from, visit, arg);
+	}
+	else if(use_arena)
+	{
+		arena_walk(from, visit, arg);
+	}
+}
+
+//Return the number of live blocks
+static size_t count_blocks()
+{
+	if(index_main != NULL)
+	{
+		return shard_size(index_main);
 	}
 
-	//set the free_flag to 1
-	node_setfree(tree_main,ptr,1);
-	free(ptr);	
+	return use_arena ? arena_live_count() : 0;
 }
 
-void *realloc537(void *ptr, size_t size) {
+//Get a block of size bytes from the chosen allocator, exiting if it fails
+static void *block_new(size_t size)
+{
+	void *retVal;
 
-	if(size == 0) {
-		fprintf(stderr, "Warning: Allocating memory of size 0\n");
+	if(use_arena)
+	{
+		node *rec = arena_alloc(size);
+		retVal = (rec == NULL) ? NULL : rec->addr;
 	}
+	else if(use_redzones)
+	{
+		size_t padded = redzone_padded(size);
+		void *base = (padded == 0) ? NULL : malloc(padded);
 
-	if (ptr == NULL) {
-		return malloc537(size);
+		retVal = (base == NULL) ? NULL : redzone_wrap(base, size);
+	}
+	else
+	{
+		retVal = malloc(size);
 	}
 
-	if ( ptr != NULL && size == 0) {
-		free537(ptr);
-		return NULL;
-		//node_setfree(tree_main,ptr,0); ????
-		
+	if(retVal == NULL)
+	{
+		fprintf(stderr, "Malloc failed");
+		exit(EXIT_FAILURE);
 	}
 
-	node_setfree(tree_main,ptr,1);
-	
-	void* rtn_ptr = realloc(ptr, size);
+	return retVal;
+}
 
-/////
+//Free a padded block once memcheck537_redzones() can no longer be reading it
+static void redzone_free(void *base, void *arg)
+{
+	(void)arg;
+	free(base);
+}
 
-	//Previous node in tree to the newly allocated memory
-	node *prevPtr = tree_find_GLT(tree_main, rtn_ptr);
+//Give a block back to the allocator it came from
+static void block_free(void *ptr)
+{
+	if(use_arena)
+	{
+		arena_free(ptr);
+	}
+	else if(use_redzones)
+	{
+		epoch_retire(redzone_base(ptr), redzone_free, NULL);
+	}
+	else
+	{
+		free(ptr);
+	}
+}
 
-	//Previous node to end of tree, indicating a node exists in the middle
-	//of the potentially allocated memory
-	node *containPtr = tree_find_GLT(tree_main, (rtn_ptr + size));
+//Add a new block to the tree, if there is one
+//Return the block's record: its arena header's, or else the tree's
+static node *track_block(void *ptr, size_t size)
+{
+	node *nodePtr = NULL;
 
+	//The tree holds only live allocations, so the new block cannot
+	//overlap a stale record
+	if(index_main != NULL)
+	{
+		nodePtr = shard_insert(index_main, ptr, size);
+	}
 
-	//Potentially Split Node
+	return use_arena ? arena_find(ptr) : nodePtr;
+}
 
-	//If the node previous to the potential node is free and is overlapping
-	//The space of the potential node, then split the node
-	if(prevPtr != NULL)
+//Point a block's granules at its record for memcheck537. Slab objects are
+//placed by address arithmetic instead, and their records are not kept
+static void shadow_block(void *ptr, size_t length, node *nodePtr)
+{
+	if(nodePtr != NULL && !(use_arena && arena_is_slab(ptr)))
 	{
-		if((prevPtr->free_flag == 1) && ((prevPtr->addr + prevPtr->length) > rtn_ptr))
-		{
-			//Reduce length of free node to be new (pointer - previous pointer)
-			prevPtr->length = (rtn_ptr - prevPtr->addr);
+		shadow_set(ptr, length, nodePtr);
+	}
+}
 
-		}		
+//Undo shadow_block for a block about to be freed or resized
+static void unshadow_block(void *ptr, size_t length, node *nodePtr)
+{
+	if(!(use_arena && arena_is_slab(ptr)))
+	{
+		shadow_clear(ptr, length, nodePtr);
 	}
-	
-	//Else if the range of the potential node includes the start of a an existing free node
-	else if(containPtr != NULL)
+}
+
+//Record origin, the site the block of length bytes at ptr was credited to,
+//in the block's record along with weight, the allocations its sample stood
+//for, and count the block as live there until it is freed. Slab objects
+//have no lasting record, so they are not counted, and neither are blocks
+//of the empty stack's site, whose id marks no site
+static void site_attach(void *ptr, size_t length, node *nodePtr, site *origin, double weight)
+{
+	node *copy;
+
+	if(origin == NULL || origin->stack == 0 || nodePtr == NULL || (use_arena && arena_is_slab(ptr)))
 	{
-		if((rtn_ptr < containPtr->addr) && (containPtr->free_flag == 1))
-		{
-			//Delete the free node from the tree
-			tree_erase(tree_main, prevPtr->addr);
-		}
+		return;
 	}
-////////
 
-	node_insert(tree_main,rtn_ptr,size);
-	return rtn_ptr;
-	
+	nodePtr->site = origin->stack;
+	nodePtr->weight = (float)weight;
 
-}
+	//The secondary index keeps its own copy of the record, used by walks
+	if(use_arena && index_main != NULL)
+	{
+		copy = shard_find(index_main, ptr);
+		copy->site = origin->stack;
+		copy->weight = (float)weight;
+	}
 
+	__atomic_fetch_add(&origin->live_bytes, length, __ATOMIC_RELAXED);
+	__atomic_fetch_add(&origin->live_blocks, 1, __ATOMIC_RELAXED);
+}
 
-void memcheck537(void *ptr, size_t size) {
+//Stop counting a block about to be freed or resized as live at its site
+//Return the site, or NULL if the block has none
+static site *site_detach(node *nodePtr)
+{
+	site *origin;
 
-	if(size == 0) {
-		fprintf(stderr, "Warning: Allocating memory of size 0\n");
+	if(nodePtr->site == 0)
+	{
+		return NULL;
 	}
 
-	if(ptr == NULL) {
-		fprintf(stderr, "Invalid address- Pointer is NULL\n");
-		exit(EXIT_FAILURE);
+	origin = site_get(nodePtr->site);
+	if(origin != NULL)
+	{
+		__atomic_fetch_sub(&origin->live_bytes, nodePtr->length, __ATOMIC_RELAXED);
+		__atomic_fetch_sub(&origin->live_blocks, 1, __ATOMIC_RELAXED);
 	}
 
-	node *nodePtr = tree_find(tree_main,ptr);
+	return origin;
+}
 
-	//Node is allocated in the tree
-	if(nodePtr != NULL)
-	{
-		if (size > nodePtr->length) {
-			fprintf(stderr, "Memory out of allocated bounds\n");
+//Check that ptr is the start of a live allocation, exiting with a
+//diagnostic if it is not. Return the tracking node of the allocation
+static node *check_live(void *ptr)
+{
+	node *nodePtr = find_block(ptr);
+
+	if (nodePtr == NULL) {
+
+		//Freed records are erased, so a recently freed block is only
+		//known through the history
+		if (history_find(ptr)) {
+			fprintf(stderr, "Node has already been freed\n");
 			exit(EXIT_FAILURE);
 		}
+
+		fprintf(stderr, "Mem not alocated by 537malloc() or bad pointer\n");
+		exit(EXIT_FAILURE);
 	}
-	else
+
+	return nodePtr;
+}
+
+//Report which redzones of the length byte block at ptr were overwritten
+static void redzone_report(void *ptr, size_t length, int damaged)
+{
+	if(damaged & REDZONE_FRONT) {
+		fprintf(stderr, "Redzone before block %p overwritten\n", ptr);
+	}
+	if(damaged & REDZONE_BACK) {
+		fprintf(stderr, "Redzone after block %p of size %zu overwritten\n", ptr, length);
+	}
+}
+
+//Check the redzones of the live block at ptr, if there are any, exiting
+//with a diagnostic if either was overwritten
+static void check_redzones(void *ptr, size_t length)
+{
+	int damaged;
+
+	if(!use_redzones)
 	{
+		return;
+	}
 
-		//ptr is potentially in the middle of an allocated block
-		//GLT -> finds greatest allocated node that is less than ptr	
-		nodePtr = tree_find_GLT(tree_main, ptr);
+	damaged = redzone_check(ptr, length);
+	if(damaged) {
+		redzone_report(ptr, length, damaged);
+		exit(EXIT_FAILURE);
+	}
+}
 
-		if(nodePtr == NULL)
-		{
-			fprintf(stderr, "Starting address exists before address of first allocated memory adddress\n");
-			exit(EXIT_FAILURE);
-		}
+//Verify a block leaving the quarantine still holds its poison and its
+//redzones, exiting with a diagnostic if it was written after it was freed,
+//then free it
+static void quarantine_evict(void *ptr, size_t length)
+{
+	if(!quarantine_intact(ptr, length)) {
+		fprintf(stderr, "Block %p of size %zu was written after it was freed\n", ptr, length);
+		exit(EXIT_FAILURE);
+	}
 
-		if(ptr > (nodePtr->addr + nodePtr->length))
-		{
-			fprintf(stderr, "Starting address is out of bounds\n");
-			exit(EXIT_FAILURE);
-		}
+	check_redzones(ptr, length);
+	block_free(ptr);
+}
 
-		if((ptr + size) > (nodePtr->addr + nodePtr->length))
+//Free a block the program is done with, holding it back in the
+//quarantine first if there is room
+static void block_release(void *ptr, size_t length)
+{
+	if(quarantine_put(ptr, length, quarantine_evict) != 0)
+	{
+		//Reads through dangling pointers see poison until the memory is reused
+		if(use_fill)
 		{
-			fprintf(stderr, "Ending address is out of bounds\n");
-			exit(EXIT_FAILURE);
+			poison_fill(ptr, length, QUARANTINE_POISON);
 		}
+		block_free(ptr);
+	}
+}
+
+//Create the tracking tree with the named index backend ("rb", "jsw" or
+//"bptree") instead of the one named by MALLOC537_INDEX. Must be called
+//before the first allocation. Return 0 on success, -1 otherwise
+int malloc537_init(const char *index)
+{
+	if(initialized || index_main != NULL || tree_backend(index) == NULL)
+	{
+		return -1;
+	}
+
+	index_main = shard_create_backend(index);
+	return 0;
+}
 
+//Choose the allocator ("libc" or "arena") instead of the one named by
+//MALLOC537_ALLOCATOR. Must be called before the first allocation
+//Return 0 on success, -1 otherwise
+int malloc537_allocator(const char *name)
+{
+	if(initialized || (strcmp(name, "libc") != 0 && strcmp(name, "arena") != 0))
+	{
+		return -1;
 	}
 
+	use_arena = (strcmp(name, "arena") == 0);
+	allocator_chosen = 1;
+	return 0;
 }
 
+//Pad every block with redzones (enable nonzero) or not, instead of
+//following MALLOC537_REDZONES. Must be called before the first allocation
+//Return 0 on success, -1 otherwise
+int malloc537_redzones(int enable)
+{
+	if(initialized)
+	{
+		return -1;
+	}
+
+	use_redzones = (enable != 0);
+	redzones_chosen = 1;
+	return 0;
+}
+
+//Fill fresh blocks with POISON_FRESH and freed ones with QUARANTINE_POISON
+//(enable nonzero) or not, instead of following MALLOC537_FILL. Must be
+//called before the first allocation. Return 0 on success, -1 otherwise
+int malloc537_fill(int enable)
+{
+	if(initialized)
+	{
+		return -1;
+	}
+
+	use_fill = (enable != 0);
+	fill_chosen = 1;
+	return 0;
+}
+
+//Record a sample of allocations, about one per bytes allocated, instead of
+//every allocation, or every allocation again with 0. Overrides
+//MALLOC537_SAMPLE_INTERVAL and may be called at any time; each thread
+//switches over at its next sample
+void malloc537_sample_interval(size_t bytes)
+{
+	sample_chosen = 1;
+	sample_set_interval(bytes);
+}
+
+//Hold back up to bytes of freed blocks in the quarantine, instead of the
+//budget named by MALLOC537_QUARANTINE. 0 turns it off. May be called at
+//any time; a smaller budget evicts the oldest blocks at once
+//Return 0 on success, -1 with the arena allocator
+int malloc537_quarantine(size_t bytes)
+{
+	if(initialized && use_arena)
+	{
+		return -1;
+	}
+
+	quarantine_chosen = 1;
+	quarantine_set_budget(bytes, quarantine_evict);
+	return 0;
+}
+
+void *malloc537(size_t size)
+{
+	if(size == 0) {
+		fprintf(stderr, "Warning: Allocating memory of size 0\n");
+	}
+
+	//If this is the first malloc, create the tree
+	setup();
+
+	void* retVal = block_new(size);
+
+	//Mark the block as never written
+	if(use_fill)
+	{
+		poison_fill(retVal, size, POISON_FRESH);
+	}
+
+	stats_alloc(size, 1);
+
+	//Add the allocation to the tree
+	node *nodePtr = track_block(retVal, size);
+
+	//Point the block's granules at its record for memcheck537
+	shadow_block(retVal, size, nodePtr);
+
+	//Add the origin address and allocation size to the list, if sampled,
+	//and count the block as live there
+	site *origin = NULL;
+	double weight = 1;
+	if(!SAMPLE_SKIP(size))
+	{
+		origin = profile_alloc(__builtin_frame_address(0), size, 1, &weight);
+		site_attach(retVal, size, nodePtr, origin, weight);
+	}
+	size_record(size, origin, weight);
+
+	return retVal;
+}
+
+void free537(void *ptr) {
+
+	if (ptr == NULL) {
+		fprintf(stderr, "Null pointer err\n");
+		exit(EXIT_FAILURE);
+	}
+
+	//Records reached by the free stay valid until the section ends
+	epoch_enter();
+
+	//check if ptr points to the first byte of a live allocation,
+	//reporting double frees and memory not allocated by 537malloc()
+	node *nodePtr = check_live(ptr);
+	size_t length = nodePtr->length;
+
+	//Catch overflows the block suffered while it was live
+	check_redzones(ptr, length);
+
+	//Reclaim the record instead of keeping a freed node in the tree
+	unshadow_block(ptr, length, nodePtr);
+	site_detach(nodePtr);
+
+	//Another thread may have freed the block since it was checked
+	if(index_main != NULL && shard_erase(index_main, ptr) != 0)
+	{
+		fprintf(stderr, "Node has already been freed\n");
+		exit(EXIT_FAILURE);
+	}
+	epoch_exit();
+
+	stats_free(length, 1);
+	history_add(ptr);
+	block_release(ptr, length);
+}
+
+//Allocate n blocks, storing a block of sizes[i] bytes in out[i]
+//The blocks are added to the tree in one ordered pass and credited to
+//the caller as n allocations in one update
+void malloc537_batch(const size_t *sizes, size_t n, void **out)
+{
+	node *items, **nodes;
+	site *origin = NULL;
+	double weight = 1;
+	size_t total = 0;
+
+	if(n == 0)
+	{
+		return;
+	}
+
+	//If this is the first malloc, create the tree
+	setup();
+
+	//Scratch space: the blocks sorted by address and their tree records
+	items = malloc(n * (sizeof(node) + sizeof(node *)));
+	if(items == NULL)
+	{
+		fprintf(stderr, "Malloc failed");
+		exit(EXIT_FAILURE);
+	}
+	nodes = (node **)(items + n);
+
+	for(size_t i = 0; i < n; i++)
+	{
+		if(sizes[i] == 0) {
+			fprintf(stderr, "Warning: Allocating memory of size 0\n");
+		}
+
+		out[i] = block_new(sizes[i]);
+		if(use_fill)
+		{
+			poison_fill(out[i], sizes[i], POISON_FRESH);
+		}
+
+		items[i].addr = out[i];
+		items[i].length = sizes[i];
+		items[i].free_flag = 0;
+		items[i].site = 0;
+		total += sizes[i];
+	}
+	stats_alloc(total, n);
+
+	//Add the blocks to the tree in address order
+	qsort(items, n, sizeof(node), node_cmp);
+	if(index_main != NULL)
+	{
+		shard_insert_batch(index_main, items, n, nodes);
+	}
+
+	if(!SAMPLE_SKIP(total))
+	{
+		origin = profile_alloc(__builtin_frame_address(0), total, n, &weight);
+	}
+
+	for(size_t i = 0; i < n; i++)
+	{
+		node *owner = use_arena ? arena_find(items[i].addr) : nodes[i];
+
+		shadow_block(items[i].addr, items[i].length, owner);
+		site_attach(items[i].addr, items[i].length, owner, origin, weight);
+	}
+
+	for(size_t i = 0; i < n; i++)
+	{
+		size_record(sizes[i], origin, weight);
+	}
+
+	free(items);
+}
+
+//Free the n blocks in ptrs. Every pointer is checked before any block is
+//freed, so a bad pointer anywhere in the batch leaves all of them allocated
+void free537_batch(void **ptrs, size_t n)
+{
+	void **sorted;
+	node **nodes, *records;
+	size_t total = 0;
+
+	if(n == 0)
+	{
+		return;
+	}
+
+	//Scratch space: the pointers sorted by address, their tree records and
+	//copies of those records. A slab object's record is rebuilt by each
+	//lookup, so only the copy taken right after its lookup stays accurate
+	records = malloc(n * (sizeof(node) + sizeof(void *) + sizeof(node *)));
+	if(records == NULL)
+	{
+		fprintf(stderr, "Malloc failed");
+		exit(EXIT_FAILURE);
+	}
+	sorted = (void **)(records + n);
+	nodes = (node **)(sorted + n);
+
+	memcpy(sorted, ptrs, n * sizeof(void *));
+	qsort(sorted, n, sizeof(void *), addr_cmp);
+
+	//Records reached by the frees stay valid until the section ends
+	epoch_enter();
+
+	for(size_t i = 0; i < n; i++)
+	{
+		if(sorted[i] == NULL) {
+			fprintf(stderr, "Null pointer err\n");
+			exit(EXIT_FAILURE);
+		}
+
+		//A pointer listed twice is freed twice
+		if(i > 0 && sorted[i] == sorted[i - 1]) {
+			fprintf(stderr, "Node has already been freed\n");
+			exit(EXIT_FAILURE);
+		}
+
+		nodes[i] = check_live(sorted[i]);
+		records[i] = *nodes[i];
+		check_redzones(sorted[i], records[i].length);
+	}
+
+	for(size_t i = 0; i < n; i++)
+	{
+		unshadow_block(sorted[i], records[i].length, nodes[i]);
+		site_detach(&records[i]);
+		total += records[i].length;
+	}
+	stats_free(total, n);
+
+	//Remove the blocks from the tree in address order. Another thread may
+	//have freed some of them since they were checked
+	if(index_main != NULL && shard_erase_batch(index_main, sorted, n) != 0)
+	{
+		fprintf(stderr, "Node has already been freed\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for(size_t i = 0; i < n; i++)
+	{
+		history_add(sorted[i]);
+		block_release(sorted[i], records[i].length);
+	}
+	epoch_exit();
+
+	free(records);
+}
+
+//Resize the live block at ptr to size bytes, moving it if needed
+//Return the block
+static void *resize_block(void *ptr, size_t size)
+{
+	node *nodePtr = check_live(ptr);
+	size_t old_length = nodePtr->length;
+	double weight = nodePtr->weight;
+	site *origin;
+	void* rtn_ptr;
+
+	//Whether an old libc block is freed here rather than by realloc, as
+	//redzones and the quarantine need
+	int by_hand = use_redzones || quarantine_budget() > 0;
+
+	check_redzones(ptr, old_length);
+	unshadow_block(ptr, old_length, nodePtr);
+
+	//The block stays credited to the site that allocated it
+	origin = site_detach(nodePtr);
+	stats_realloc(old_length, size);
+	size_record(size, origin, weight);
+
+	if(use_arena)
+	{
+		//Stay in place while the size fits the block's size class
+		if(arena_resize(ptr, size) == 0)
+		{
+			rtn_ptr = ptr;
+		}
+		else
+		{
+			rtn_ptr = block_new(size);
+			memcpy(rtn_ptr, ptr, old_length < size ? old_length : size);
+		}
+	}
+	else if(by_hand)
+	{
+		//Shrink in place, moving the back redzone down, otherwise move
+		if(size <= old_length)
+		{
+			rtn_ptr = use_redzones ? redzone_wrap(redzone_base(ptr), size) : ptr;
+		}
+		else
+		{
+			rtn_ptr = block_new(size);
+			memcpy(rtn_ptr, ptr, old_length);
+		}
+	}
+	else
+	{
+		//realloc frees the old block when it moves it, and another thread
+		//may be handed its address straight away, so the old record must
+		//be gone first. The block is then tracked anew, moved or not
+		if(index_main != NULL)
+		{
+			shard_erase(index_main, ptr);
+		}
+
+		rtn_ptr = realloc(ptr, size);
+		if(rtn_ptr == NULL)
+		{
+			fprintf(stderr, "Realloc failed");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	//The grown part has never been written
+	if(use_fill && size > old_length)
+	{
+		poison_fill((char *)rtn_ptr + old_length, size - old_length, POISON_FRESH);
+	}
+
+	//The record of a block realloc took was already erased
+	if(!use_arena && !by_hand)
+	{
+		if(rtn_ptr != ptr)
+		{
+			history_add(ptr);
+		}
+		nodePtr = track_block(rtn_ptr, size);
+		shadow_block(rtn_ptr, size, nodePtr);
+		site_attach(rtn_ptr, size, nodePtr, origin, weight);
+		return rtn_ptr;
+	}
+
+	//Resized in place, only the length changes
+	if(rtn_ptr == ptr)
+	{
+		nodePtr->length = size;
+
+		//The secondary index keeps its own copy of the record
+		if(use_arena && index_main != NULL)
+		{
+			shard_find(index_main, ptr)->length = size;
+		}
+
+		shadow_block(rtn_ptr, size, nodePtr);
+		site_attach(rtn_ptr, size, nodePtr, origin, weight);
+		return rtn_ptr;
+	}
+
+	//The block moved, replace the old record
+	if(index_main != NULL)
+	{
+		shard_erase(index_main, ptr);
+	}
+	history_add(ptr);
+	block_release(ptr, old_length);
+	nodePtr = track_block(rtn_ptr, size);
+	shadow_block(rtn_ptr, size, nodePtr);
+	site_attach(rtn_ptr, size, nodePtr, origin, weight);
+	return rtn_ptr;
+}
+
+void *realloc537(void *ptr, size_t size) {
+
+	if(size == 0) {
+		fprintf(stderr, "Warning: Allocating memory of size 0\n");
+	}
+
+	if (ptr == NULL) {
+		return malloc537(size);
+	}
+
+	if ( ptr != NULL && size == 0) {
+		free537(ptr);
+		return NULL;
+	}
+
+	//Records reached while resizing stay valid until the section ends
+	epoch_enter();
+	void* rtn_ptr = resize_block(ptr, size);
+	epoch_exit();
+
+	return rtn_ptr;
+}
+
+
+//Classify the range [ptr, ptr + size) against nodePtr, the block with the
+//greatest address that is not above ptr, or NULL if there is none
+static memcheck537_status check_range(void *ptr, size_t size, node *nodePtr)
+{
+	if(nodePtr == NULL)
+	{
+		return MEMCHECK537_BEFORE_FIRST;
+	}
+
+	if(ptr == nodePtr->addr)
+	{
+		return size > nodePtr->length ? MEMCHECK537_SIZE_OUT_OF_BOUNDS : MEMCHECK537_OK;
+	}
+
+	if(ptr > (nodePtr->addr + nodePtr->length))
+	{
+		return MEMCHECK537_START_OUT_OF_BOUNDS;
+	}
+
+	if((ptr + size) > (nodePtr->addr + nodePtr->length))
+	{
+		return MEMCHECK537_END_OUT_OF_BOUNDS;
+	}
+
+	return MEMCHECK537_OK;
+}
+
+//Return the block owning ptr's granule if the shadow map knows it and ptr
+//lies inside it, NULL otherwise
+static node *shadow_owner(void *ptr)
+{
+	node *nodePtr = shadow_find(ptr);
+
+	if(nodePtr != NULL && ptr >= nodePtr->addr && ptr < (nodePtr->addr + nodePtr->length))
+	{
+		return nodePtr;
+	}
+
+	return NULL;
+}
+
+//Classify one range with a lookup of its own
+static memcheck537_status memcheck_one(void *ptr, size_t size)
+{
+	node *nodePtr;
+
+	if(ptr == NULL)
+	{
+		return MEMCHECK537_NULL;
+	}
+
+	//Fast path: the shadow map names the block owning ptr's granule
+	nodePtr = shadow_owner(ptr);
+	if(nodePtr != NULL)
+	{
+		return check_range(ptr, size, nodePtr);
+	}
+
+	//Blocks that are not shadowed (unaligned or empty) and every error
+	//case are resolved through the tree, or the arena headers
+
+	//ptr is either the start of a block or potentially in the middle of one
+	//GLT -> finds greatest allocated node that is less than ptr
+	nodePtr = find_block(ptr);
+	if(nodePtr == NULL)
+	{
+		nodePtr = find_block_GLT(ptr);
+	}
+
+	return check_range(ptr, size, nodePtr);
+}
+
+void memcheck537(void *ptr, size_t size) {
+
+	if(size == 0) {
+		fprintf(stderr, "Warning: Allocating memory of size 0\n");
+	}
+
+	//Records reached by the check stay valid until the section ends
+	epoch_enter();
+	memcheck537_status status = memcheck_one(ptr, size);
+	epoch_exit();
+
+	switch(status)
+	{
+		case MEMCHECK537_OK:
+			return;
+
+		case MEMCHECK537_NULL:
+			fprintf(stderr, "Invalid address- Pointer is NULL\n");
+			break;
+
+		case MEMCHECK537_BEFORE_FIRST:
+			fprintf(stderr, "Starting address exists before address of first allocated memory adddress\n");
+			break;
+
+		case MEMCHECK537_SIZE_OUT_OF_BOUNDS:
+			fprintf(stderr, "Memory out of allocated bounds\n");
+			break;
+
+		case MEMCHECK537_START_OUT_OF_BOUNDS:
+			fprintf(stderr, "Starting address is out of bounds\n");
+			break;
+
+		case MEMCHECK537_END_OUT_OF_BOUNDS:
+			fprintf(stderr, "Ending address is out of bounds\n");
+			break;
+	}
+
+	exit(EXIT_FAILURE);
+}
+
+//A query of memcheck537_many left for the sweep, with its position in the
+//caller's arrays
+typedef struct memcheck_query
+{
+	void *ptr;
+	size_t index;
+} memcheck_query;
+
+//State of the merge between the sorted queries and the tree walk
+typedef struct memcheck_sweep
+{
+	memcheck_query *queries;
+	size_t next;
+	size_t n;
+	const size_t *sizes;
+	memcheck537_status *status;
+	node *pred;
+	node pred_copy;
+} memcheck_sweep;
+
+//Order two queries by address for qsort
+static int query_cmp(const void *p1, const void *p2)
+{
+	uintptr_t addr1 = (uintptr_t)((const memcheck_query *)p1)->ptr;
+	uintptr_t addr2 = (uintptr_t)((const memcheck_query *)p2)->ptr;
+
+	return (addr1 > addr2) - (addr1 < addr2);
+}
+
+//Answer every query below the visited node from the node before it, then
+//make the visited node the predecessor of the queries that follow
+static int sweep_visit(node *visited, void *arg)
+{
+	memcheck_sweep *sweep = arg;
+
+	while(sweep->next < sweep->n && sweep->queries[sweep->next].ptr < visited->addr)
+	{
+		memcheck_query *query = &sweep->queries[sweep->next++];
+
+		sweep->status[query->index] = check_range(query->ptr, sweep->sizes[query->index], sweep->pred);
+	}
+
+	//Visited records may be rebuilt for each visit, so keep a copy
+	sweep->pred_copy = *visited;
+	sweep->pred = &sweep->pred_copy;
+
+	//Stop once every query is answered
+	return sweep->next == sweep->n;
+}
+
+//Check n ranges at once for memcheck537_many
+static memcheck537_status *check_many(const void **ptrs, const size_t *sizes, size_t n)
+{
+	memcheck537_status *status;
+	memcheck_query *queries;
+	memcheck_sweep sweep;
+	size_t misses = 0, live;
+	int depth;
+
+	status = malloc((n == 0 ? 1 : n) * sizeof(memcheck537_status));
+	queries = malloc((n == 0 ? 1 : n) * sizeof(memcheck_query));
+	if(status == NULL || queries == NULL)
+	{
+		fprintf(stderr, "Malloc failed");
+		exit(EXIT_FAILURE);
+	}
+
+	//Ranges inside a shadowed block are answered directly, the rest are
+	//left for a tree search
+	for(size_t i = 0; i < n; i++)
+	{
+		void *ptr = (void *)ptrs[i];
+		node *nodePtr = (ptr == NULL || !initialized) ? NULL : shadow_owner(ptr);
+
+		if(ptr == NULL)
+		{
+			status[i] = MEMCHECK537_NULL;
+		}
+		else if(!initialized)
+		{
+			status[i] = MEMCHECK537_BEFORE_FIRST;
+		}
+		else if(nodePtr != NULL)
+		{
+			status[i] = check_range(ptr, sizes[i], nodePtr);
+		}
+		else
+		{
+			queries[misses].ptr = ptr;
+			queries[misses].index = i;
+			misses++;
+		}
+	}
+
+	if(misses == 0)
+	{
+		free(queries);
+		return status;
+	}
+
+	//A sweep costs up to one step per live block, separate searches one
+	//descent each. Only sweep when the descents would cost more
+	live = count_blocks();
+	depth = 64 - __builtin_clzl(live | 1);
+	if(misses * depth < live)
+	{
+		for(size_t i = 0; i < misses; i++)
+		{
+			size_t index = queries[i].index;
+
+			status[index] = memcheck_one(queries[i].ptr, sizes[index]);
+		}
+
+		free(queries);
+		return status;
+	}
+
+	//Merge the sorted queries with one in-order walk of the tree, starting
+	//at the block that holds or precedes the lowest query
+	qsort(queries, misses, sizeof(memcheck_query), query_cmp);
+
+	sweep.queries = queries;
+	sweep.next = 0;
+	sweep.n = misses;
+	sweep.sizes = sizes;
+	sweep.status = status;
+	sweep.pred = find_block(queries[0].ptr);
+	if(sweep.pred == NULL)
+	{
+		sweep.pred = find_block_GLT(queries[0].ptr);
+	}
+	if(sweep.pred != NULL)
+	{
+		sweep.pred_copy = *sweep.pred;
+		sweep.pred = &sweep.pred_copy;
+	}
+
+	walk_blocks(sweep.pred == NULL ? NULL : sweep.pred->addr, sweep_visit, &sweep);
+
+	//Queries past the last block follow it
+	while(sweep.next < misses)
+	{
+		memcheck_query *query = &queries[sweep.next++];
+
+		status[query->index] = check_range(query->ptr, sizes[query->index], sweep.pred);
+	}
+
+	free(queries);
+	return status;
+}
+
+//Check n ranges at once, the i-th starting at ptrs[i] and sizes[i] bytes long
+//Unlike memcheck537 nothing is printed and the program does not exit.
+//Return a status per range, allocated with malloc and freed by the caller
+memcheck537_status *memcheck537_many(const void **ptrs, const size_t *sizes, size_t n)
+{
+	memcheck537_status *status;
+
+	//Records reached by the checks stay valid until the section ends
+	epoch_enter();
+	status = check_many(ptrs, sizes, n);
+	epoch_exit();
+
+	return status;
+}
+
+//A caller's visit function and argument, passed through shard_find_overlapping
+typedef struct overlap_visitor
+{
+	malloc537_visit_f visit;
+	void *arg;
+} overlap_visitor;
+
+//Hand one overlapping node to the caller as an address and a length
+static int overlap_report(node *visited, void *arg)
+{
+	overlap_visitor *visitor = arg;
+
+	return visitor->visit(visited->addr, visited->length, visitor->arg);
+}
+
+//Visit, in address order, every live allocation that intersects [lo, hi)
+//until visit returns nonzero
+void malloc537_overlapping(void *lo, void *hi, malloc537_visit_f visit, void *arg)
+{
+	overlap_visitor visitor;
+
+	visitor.visit = visit;
+	visitor.arg = arg;
+
+	//The block before lo is reported from its record, kept valid by the section
+	epoch_enter();
+	if(index_main != NULL)
+	{
+		shard_find_overlapping(index_main, lo, hi, overlap_report, &visitor);
+	}
+	else if(use_arena)
+	{
+		arena_find_overlapping(lo, hi, overlap_report, &visitor);
+	}
+	epoch_exit();
+}
+
+//Count and report a visited block whose redzones were overwritten
+static int redzone_visit(node *visited, void *arg)
+{
+	int damaged = redzone_check(visited->addr, visited->length);
+
+	if(damaged)
+	{
+		redzone_report(visited->addr, visited->length, damaged);
+		(*(size_t *)arg)++;
+	}
+
+	return 0;
+}
+
+//Compare the redzones of every live block with the canary, reporting each
+//block whose redzones were overwritten. Unlike memcheck537 it does not
+//exit, so it can be run periodically. Return the number of damaged blocks,
+//0 if redzones are off
+size_t memcheck537_redzones()
+{
+	size_t damaged = 0;
+
+	if(!use_redzones)
+	{
+		return 0;
+	}
+
+	//Blocks freed during the sweep are not reclaimed until it ends
+	epoch_enter();
+	walk_blocks(NULL, redzone_visit, &damaged);
+	epoch_exit();
+
+	return damaged;
+}
+
+//Totals gathered by the leak report's walk
+typedef struct leak_totals
+{
+	size_t bytes;
+	size_t blocks;
+	size_t unattributed_bytes;
+	size_t unattributed_blocks;
+	size_t slab_bytes;
+	size_t slab_blocks;
+} leak_totals;
+
+//Count a live block, and credit it to its site's leaked counts, weighted
+//like its allocation was when it was sampled. A batch is sampled as a
+//whole, so its blocks carry the batch's weight rather than their own
+//Arena slab objects keep no site, so they are counted on their own
+static int leak_visit(node *visited, void *arg)
+{
+	leak_totals *totals = arg;
+	site *origin = (visited->site == 0) ? NULL : site_get(visited->site);
+
+	totals->bytes += visited->length;
+	totals->blocks++;
+
+	if(use_arena && arena_is_slab(visited->addr))
+	{
+		totals->slab_bytes += visited->length;
+		totals->slab_blocks++;
+		return 0;
+	}
+
+	if(origin == NULL)
+	{
+		totals->unattributed_bytes += visited->length;
+		totals->unattributed_blocks++;
+		return 0;
+	}
+
+	origin->leaked_bytes += (size_t)(visited->length * visited->weight + 0.5);
+	origin->leaked_blocks += (size_t)(visited->weight + 0.5);
+
+	return 0;
+}
+
+//Order sites by bytes leaked, most first
+static int leak_cmp(const void *p1, const void *p2)
+{
+	size_t bytes1 = (*(site * const *)p1)->leaked_bytes;
+	size_t bytes2 = (*(site * const *)p2)->leaked_bytes;
+
+	return (bytes1 < bytes2) - (bytes1 > bytes2);
+}
+
+//Print the top sites by bytes still allocated, with their call stacks, to
+//stderr. Each live block is visited once and credited to the site stored
+//in its record, so the report costs one walk of the live blocks. With
+//sampling on, the per site figures are estimates like view_allocations'
+void malloc537_leak_report(size_t top)
+{
+	static pthread_mutex_t report_lock = PTHREAD_MUTEX_INITIALIZER;
+	leak_totals totals = { 0, 0, 0, 0, 0, 0 };
+	void *const *frames;
+	site **sites;
+	size_t n;
+	int depth;
+
+	pthread_mutex_lock(&report_lock);
+
+	sites = site_snapshot(&n);
+	if(sites == NULL)
+	{
+		fprintf(stderr, "Malloc failed");
+		exit(EXIT_FAILURE);
+	}
+
+	for(size_t i = 0; i < n; i++)
+	{
+		sites[i]->leaked_bytes = 0;
+		sites[i]->leaked_blocks = 0;
+	}
+
+	//Records of blocks freed during the walk stay readable until it ends
+	epoch_enter();
+	walk_blocks(NULL, leak_visit, &totals);
+	epoch_exit();
+
+	qsort(sites, n, sizeof(site *), leak_cmp);
+
+	fprintf(stderr, "Leak report: %zu bytes in %zu blocks still allocated\n", totals.bytes, totals.blocks);
+
+	for(size_t i = 0; i < n && i < top && sites[i]->leaked_bytes > 0; i++)
+	{
+		frames = depot_get(sites[i]->stack, &depth);
+
+		fprintf(stderr, "%zu bytes in %zu blocks allocated at %p\n", sites[i]->leaked_bytes, sites[i]->leaked_blocks, depth > 0 ? frames[0] : NULL);
+		for(int j = 1; j < depth; j++)
+		{
+			fprintf(stderr, "\tcalled from %p\n", frames[j]);
+		}
+	}
+
+	if(totals.unattributed_blocks > 0)
+	{
+		fprintf(stderr, "%zu bytes in %zu blocks %s\n", totals.unattributed_bytes, totals.unattributed_blocks, sample_interval() > 0 ? "were not sampled" : "not attributed to a site");
+	}
+
+	if(totals.slab_blocks > 0)
+	{
+		fprintf(stderr, "%zu bytes in %zu blocks are slab objects, which are not attributed to a site\n", totals.slab_bytes, totals.slab_blocks);
+	}
+
+	pthread_mutex_unlock(&report_lock);
+	site_snapshot_free(sites);
+}
+
+//Fill out with the heap's statistics. The counts are kept per thread and
+//summed here, so an allocation costs no shared write. metadata_bytes counts
+//what is mapped for records, the shadow, the index, the profile, the lists
+//of retired objects and the quarantine, plus the redzones around live
+//blocks; arena spans are not counted, as they mostly hold the blocks
+//themselves
+void malloc537_stats(struct malloc537_stats *out)
+{
+	heap_stats totals;
+
+	stats_read(&totals);
+
+	out->live_bytes = totals.live_bytes;
+	out->live_blocks = totals.live_blocks;
+	out->peak_bytes = totals.peak_bytes;
+	out->allocs = totals.allocs;
+	out->frees = totals.frees;
+	out->reallocs = totals.reallocs;
+
+	out->metadata_bytes = pool_total_mapped() + shadow_mapped_bytes() + ptr_hash_total_mapped()
+						  + depot_mapped_bytes() + site_mapped_bytes() + epoch_mapped_bytes()
+						  + quarantine_mapped_bytes();
+	if(index_main != NULL)
+	{
+		out->metadata_bytes += shard_mapped_bytes(index_main);
+	}
+	if(use_redzones)
+	{
+		out->metadata_bytes += totals.live_blocks * 2 * REDZONE_SIZE;
+	}
+}
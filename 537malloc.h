@@ -1,7 +1,28 @@
 #ifndef MALLOC_H
 #define MALLOC_H
 
-#define BUFF_SIZE 1024
+//Number of freed addresses remembered for double free detection
+#define FREE_HISTORY_SIZE 4096
+
+//Environment variable naming the allocator: "libc" (the default) or "arena"
+#define ALLOCATOR_ENV "MALLOC537_ALLOCATOR"
+
+//Environment variable asking for a leak report at exit, holding the number
+//of sites to print or empty for LEAK_REPORT_TOP
+#define LEAK_REPORT_ENV "MALLOC537_LEAK_REPORT"
+#define LEAK_REPORT_TOP 10
+
+int malloc537_init(const char *index);
+
+int malloc537_allocator(const char *name);
+
+int malloc537_redzones(int enable);
+
+int malloc537_quarantine(size_t bytes);
+
+int malloc537_fill(int enable);
+
+void malloc537_sample_interval(size_t bytes);
 
 void *malloc537(size_t size);
 
@@ -9,16 +30,53 @@ void free537(void *ptr);
 
 void *realloc537(void *ptr, size_t size);
 
+void malloc537_batch(const size_t *sizes, size_t n, void **out);
+
+void free537_batch(void **ptrs, size_t n);
+
 void memcheck537(void *ptr, size_t size);
 
+//Result of checking one range with memcheck537_many
+typedef enum memcheck537_status{
+    MEMCHECK537_OK = 0,
+    MEMCHECK537_NULL,                   //Pointer is NULL
+    MEMCHECK537_BEFORE_FIRST,           //Starts before the first allocation
+    MEMCHECK537_SIZE_OUT_OF_BOUNDS,     //Starts a block but is longer than it
+    MEMCHECK537_START_OUT_OF_BOUNDS,    //Starts outside every block
+    MEMCHECK537_END_OUT_OF_BOUNDS       //Starts inside a block but ends past it
+}memcheck537_status;
+
+memcheck537_status *memcheck537_many(const void **ptrs, const size_t *sizes, size_t n);
+
+//Called for each allocation found by malloc537_overlapping, return nonzero to stop
+typedef int (*malloc537_visit_f)(void *addr, size_t length, void *arg);
+
+void malloc537_overlapping(void *lo, void *hi, malloc537_visit_f visit, void *arg);
+
+size_t memcheck537_redzones();
+
 void view_allocations();
 
+void view_sizes();
+
+size_t malloc537_size_histogram(size_t *counts, size_t *lower, size_t n);
+
+size_t malloc537_size_percentile(double pct);
+
+void malloc537_leak_report(size_t top);
+
+//Heap statistics returned by malloc537_stats
+struct malloc537_stats{
+    size_t live_bytes;          //Bytes in live blocks, as requested
+    size_t live_blocks;         //Blocks allocated and not yet freed
+    size_t peak_bytes;          //Most live bytes seen at once, exact with one thread
+                                //and within 64KB per other thread otherwise
+    size_t allocs;              //Blocks ever allocated
+    size_t frees;               //Blocks ever freed
+    size_t reallocs;            //Blocks ever resized by realloc537
+    size_t metadata_bytes;      //Bytes mapped for tracking, plus redzones
+};
 
-//Structure used to hold list of allocation origin addresses- Extra Credit
-typedef struct addr_node{
-    void* addr;
-    size_t allocated_bytes;
-    int num_allocations;
-}addr_node;
+void malloc537_stats(struct malloc537_stats *out);
 
 #endif
@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "537malloc.h"
+#include <time.h>
+
+#define LIMIT 100000
+#define BATCH 1000
+
+int main() {
+	static char *ptr[LIMIT];
+	static size_t sizes[BATCH];
+	static size_t check_sizes[LIMIT];
+	int i = 0;
+
+	for(i = 0; i < BATCH; i++) {
+		sizes[i] = 1 + (i % 64);
+	}
+
+	clock_t startTimeAlloc = clock();
+	for(i = 0; i < LIMIT; i += BATCH) {
+		malloc537_batch(sizes, BATCH, (void **)&ptr[i]);
+	}
+	clock_t endTimeAlloc = clock();
+
+	clock_t startTimeMemCheck = clock();
+	for(i = 0; i < LIMIT; i++) {
+		memcheck537(ptr[i], sizes[i % BATCH]);
+	}
+	clock_t endTimeMemCheck = clock();
+
+	for(i = 0; i < LIMIT; i++) {
+		check_sizes[i] = sizes[i % BATCH];
+	}
+
+	clock_t startTimeMemCheckMany = clock();
+	memcheck537_status *status = memcheck537_many((const void **)ptr, check_sizes, LIMIT);
+	clock_t endTimeMemCheckMany = clock();
+
+	for(i = 0; i < LIMIT; i++) {
+		if(status[i] != MEMCHECK537_OK) {
+			printf("Mem check many failed at %p\n", ptr[i]);
+			return 1;
+		}
+	}
+	free(status);
+
+	clock_t startTimeFree = clock();
+	for(i = 0; i < LIMIT; i += BATCH) {
+		free537_batch((void **)&ptr[i], BATCH);
+	}
+	clock_t endTimeFree = clock();
+
+	view_allocations();
+
+	printf("If this prints, you get points!\n");
+	printf("Batch Alloc Time Taken : %f secs\n", ((double)endTimeAlloc - startTimeAlloc) / CLOCKS_PER_SEC);
+	printf("Memcheck Time Taken : %f secs\n", ((double)endTimeMemCheck - startTimeMemCheck) / CLOCKS_PER_SEC);
+	printf("Memcheck Many Time Taken : %f secs\n", ((double)endTimeMemCheckMany - startTimeMemCheckMany) / CLOCKS_PER_SEC);
+	printf("Batch Free Time Taken : %f secs\n", ((double)endTimeFree - startTimeFree) / CLOCKS_PER_SEC);
+}
@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "537malloc.h"
+
+#define MAX_THREADS 8
+#define OPS 100000
+#define LIVE 64
+
+//Blocks handed from each thread to the next, freed by the receiver
+static void *handoff[MAX_THREADS];
+
+//Each thread allocates, checks and frees its own blocks, and frees one
+//block in every sixteen on the next thread
+static void *worker(void *arg) {
+	long id = ((long *)arg)[0];
+	long threads = ((long *)arg)[1];
+	static __thread char *live[LIVE];
+	static __thread size_t sizes[LIVE];
+	unsigned int seed = id * 7919 + 1;
+	int i;
+
+	for(i = 0; i < OPS; i++) {
+		int slot = i % LIVE;
+		size_t size;
+		char *ptr;
+
+		if(live[slot] != NULL) {
+			memcheck537(live[slot] + sizes[slot] / 2, sizes[slot] - sizes[slot] / 2);
+			free537(live[slot]);
+		}
+
+		seed = seed * 1103515245 + 12345;
+		size = 1 + (seed >> 16) % 512;
+		ptr = malloc537(size);
+		ptr[0] = ptr[size - 1] = (char)id;
+
+		if(i % 16 == 0) {
+			ptr = __atomic_exchange_n(&handoff[(id + 1) % threads], ptr, __ATOMIC_ACQ_REL);
+			if(ptr != NULL) {
+				free537(ptr);
+			}
+			live[slot] = NULL;
+			continue;
+		}
+
+		live[slot] = ptr;
+		sizes[slot] = size;
+	}
+
+	for(i = 0; i < LIVE; i++) {
+		if(live[i] != NULL) {
+			free537(live[i]);
+			live[i] = NULL;
+		}
+	}
+
+	return NULL;
+}
+
+//Count the blocks the index still holds
+static int count_block(void *addr, size_t length, void *arg) {
+	(void)addr;
+	(void)length;
+	(*(size_t *)arg)++;
+	return 0;
+}
+
+//Runs threads that allocate, check and free their own blocks and each
+//other's, then checks that every block was accounted for: tracking errors
+//exit from inside the workers, and nothing may be left in the index
+//(thread_benchmark.c times the same workload)
+int main() {
+	pthread_t tid[MAX_THREADS];
+	long args[MAX_THREADS][2];
+	struct malloc537_stats stats;
+	size_t left;
+	long threads;
+	int i;
+
+	for(threads = 1; threads <= MAX_THREADS; threads *= 2) {
+		for(i = 0; i < threads; i++) {
+			args[i][0] = i;
+			args[i][1] = threads;
+			pthread_create(&tid[i], NULL, worker, args[i]);
+		}
+		for(i = 0; i < threads; i++) {
+			pthread_join(tid[i], NULL);
+		}
+		for(i = 0; i < threads; i++) {
+			if(handoff[i] != NULL) {
+				free537(handoff[i]);
+				handoff[i] = NULL;
+			}
+		}
+
+		left = 0;
+		malloc537_overlapping((void *)1, (void *)UINTPTR_MAX, count_block, &left);
+		malloc537_stats(&stats);
+
+		if(left != 0 || stats.live_blocks != 0 || stats.live_bytes != 0 || stats.allocs != stats.frees) {
+			printf("Threads: %ld left %zu blocks indexed, stats say %zu blocks of %zu bytes live, %zu allocs and %zu frees\n",
+				threads, left, stats.live_blocks, stats.live_bytes, stats.allocs, stats.frees);
+			return 1;
+		}
+		printf("Threads: %ld, %zu blocks allocated in all, none left\n", threads, stats.allocs);
+	}
+
+	printf("If this prints, you get points!\n");
+
+	return 0;
+}
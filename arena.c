@@ -0,0 +1,871 @@
+//For PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP
+#define _GNU_SOURCE
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "slab.h"
+#include "epoch.h"
+#include "pool.h"
+#include "arena.h"
+
+//What an arena's memory is carved into
+#define ARENA_KIND_BLOCKS 0
+#define ARENA_KIND_SPAN 1
+#define ARENA_KIND_SLABS 2
+
+//An arena, a large span or a run of slabs. The mapping starts with this
+//descriptor, then for blocks a bitmap with one bit per granule marking where
+//each live block starts, then the blocks or slabs from base up to the bump
+//pointer next. Slabs keep their own bitmaps and start on a slab boundary
+typedef struct arena
+{
+	char *base;
+	char *next;
+	char *end;
+	size_t bytes;
+	int kind;
+	uint64_t starts[];
+
+} arena;
+
+//A thread's slabs. Each slab belongs to one cache, and only the thread
+//using the cache takes or releases its objects. Objects freed by other
+//threads are pushed onto remote, linked through their first word, and
+//released by the owner on its next allocation
+typedef struct arena_cache
+{
+	slab *partial[SLAB_CLASSES];
+	void *remote;
+	struct arena_cache *next;
+
+} arena_cache;
+
+//Guards the registry, the headed blocks and the carving of new slabs.
+//Recursive so a walk's visit function may call back into the allocator
+static pthread_mutex_t arena_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+//Every arena and span, sorted by address
+static arena *arenas[ARENA_MAX];
+static int arena_count;
+
+//The slab arena covering each ARENA_BYTES of the address space, so slab
+//objects are found without taking the lock
+static arena *regions[ARENA_REGIONS];
+
+//The arenas new blocks and new slabs are carved from
+static arena *current;
+static arena *current_slabs;
+
+//Free blocks of each size class, linked through their first word
+static arena_header *bins[ARENA_CLASSES];
+
+//The calling thread's cache, and the caches of threads that have exited,
+//waiting to be taken over by new threads. Caches come from a pool, so they
+//are counted with the tracker's metadata rather than the heap
+static __thread arena_cache *cache;
+static arena_cache *abandoned;
+static pool cache_pool = POOL_INITIALIZER(sizeof(arena_cache));
+static pthread_key_t cache_key;
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+
+//Slab objects have no header, so their records are built on lookup. A record
+//handed out for one stays valid until the thread's next arena call
+static __thread node slab_rec;
+
+static size_t live_count;
+static size_t mapped_bytes;
+
+//Return the size class of a request and set class_size to the bytes a
+//block of that class holds. Classes step by one granule up to
+//ARENA_SMALL_MAX, then by a quarter of the power of two below the size
+static int size_class(size_t size, size_t *class_size)
+{
+	int p;
+	size_t step;
+
+	if (size <= ARENA_SMALL_MAX)
+	{
+		*class_size = (size == 0) ? ARENA_GRANULE : (size + ARENA_GRANULE - 1) & ~(ARENA_GRANULE - 1);
+		return (int)(*class_size >> ARENA_GRANULE_SHIFT) - 1;
+	}
+
+	//2^p < size <= 2^(p + 1)
+	p = 63 - __builtin_clzl(size - 1);
+	step = 1UL << (p - 2);
+	*class_size = ((size - 1) / step + 1) * step;
+
+	return (int)(ARENA_SMALL_MAX >> ARENA_GRANULE_SHIFT) + (p - 10) * 4 + (int)(*class_size >> (p - 2)) - 5;
+}
+
+//Return the index of the last arena that starts at or below ptr, or -1
+static int arena_below(void *ptr)
+{
+	int lo = 0, hi = arena_count;
+
+	while (lo < hi)
+	{
+		int mid = (lo + hi) / 2;
+
+		if ((char *)arenas[mid] <= (char *)ptr)
+		{
+			lo = mid + 1;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+
+	return lo - 1;
+}
+
+//Map ARENA_BYTES aligned to ARENA_BYTES, trimming an oversized mapping
+//Return the memory, or MAP_FAILED
+static void *map_aligned()
+{
+	char *mem = mmap(NULL, 2 * ARENA_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	char *aligned;
+
+	if (mem == MAP_FAILED)
+	{
+		return MAP_FAILED;
+	}
+
+	aligned = (char *)(((uintptr_t)mem + ARENA_BYTES - 1) & ~(ARENA_BYTES - 1));
+	if (aligned != mem)
+	{
+		munmap(mem, aligned - mem);
+	}
+	munmap(aligned + ARENA_BYTES, mem + ARENA_BYTES - aligned);
+
+	return aligned;
+}
+
+//Map an arena of the given kind whose blocks or slabs can use at least
+//data bytes and add it to the registry. A slab arena fills an aligned
+//ARENA_BYTES, its first slab taking the place of the descriptor
+//Return the arena, or NULL if it could not be mapped
+static arena *arena_map(size_t data, int kind)
+{
+	size_t words = (kind == ARENA_KIND_SLABS) ? 0 : ((data >> ARENA_GRANULE_SHIFT) + 63) / 64;
+	size_t head = (sizeof(arena) + words * sizeof(uint64_t) + 63) & ~(size_t)63;
+	size_t bytes;
+	arena *a;
+	int i;
+
+	if (kind == ARENA_KIND_SLABS)
+	{
+		head = SLAB_BYTES;
+		data = ARENA_BYTES - SLAB_BYTES;
+	}
+	bytes = (head + data + 4095) & ~(size_t)4095;
+
+	if (arena_count == ARENA_MAX)
+	{
+		return NULL;
+	}
+
+	a = (kind == ARENA_KIND_SLABS) ? map_aligned()
+								   : mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (a == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	//Blocks may only use the data bytes the bitmap covers
+	a->base = (char *)a + head;
+	a->next = a->base;
+	a->end = a->base + data;
+	a->bytes = bytes;
+	a->kind = kind;
+	__atomic_fetch_add(&mapped_bytes, bytes, __ATOMIC_RELAXED);
+
+	if (kind == ARENA_KIND_SLABS)
+	{
+		if (((uintptr_t)a >> ARENA_SHIFT) >= ARENA_REGIONS)
+		{
+			munmap(a, bytes);
+			__atomic_fetch_sub(&mapped_bytes, bytes, __ATOMIC_RELAXED);
+			return NULL;
+		}
+		__atomic_store_n(&regions[(uintptr_t)a >> ARENA_SHIFT], a, __ATOMIC_RELEASE);
+	}
+
+	//Keep the registry sorted so lookups can binary search it
+	i = arena_below(a) + 1;
+	memmove(&arenas[i + 1], &arenas[i], (arena_count - i) * sizeof(arena *));
+	arenas[i] = a;
+	arena_count++;
+
+	return a;
+}
+
+//Unmap a span once no epoch reader can still be reading its header
+static void span_unmap(void *obj, void *arg)
+{
+	arena *a = obj;
+
+	(void)arg;
+	__atomic_fetch_sub(&mapped_bytes, a->bytes, __ATOMIC_RELAXED);
+	munmap(a, a->bytes);
+}
+
+//Remove a large span from the registry and unmap it. memcheck537 may be
+//reading its block's record through the shadow map without the lock, so
+//the unmap waits for an epoch grace period
+static void arena_unmap(arena *a)
+{
+	int i = arena_below(a);
+
+	memmove(&arenas[i], &arenas[i + 1], (arena_count - i - 1) * sizeof(arena *));
+	arena_count--;
+
+	epoch_retire(a, span_unmap, NULL);
+}
+
+//Return the bit of the arena's bitmap that marks a block starting at ptr
+static size_t start_bit(arena *a, void *ptr)
+{
+	return (size_t)((char *)ptr - a->base) >> ARENA_GRANULE_SHIFT;
+}
+
+//Return the header of the block whose start is marked by the given bit
+static arena_header *header_at(arena *a, size_t bit)
+{
+	return (arena_header *)(a->base + (bit << ARENA_GRANULE_SHIFT)) - 1;
+}
+
+//Return the arena whose used memory holds ptr, or NULL if there is none
+static arena *arena_at(void *ptr)
+{
+	int i = arena_below(ptr);
+
+	if (i < 0 || (char *)ptr < arenas[i]->base || (char *)ptr >= arenas[i]->next)
+	{
+		return NULL;
+	}
+
+	return arenas[i];
+}
+
+//Return the slab arena whose carved slabs hold ptr, or NULL if there is
+//none. Needs no lock: slab arenas are never unmapped
+static arena *slabs_at(void *ptr)
+{
+	uintptr_t region = (uintptr_t)ptr >> ARENA_SHIFT;
+	arena *a;
+
+	if (region >= ARENA_REGIONS)
+	{
+		return NULL;
+	}
+
+	a = __atomic_load_n(&regions[region], __ATOMIC_ACQUIRE);
+	if (a == NULL || (char *)ptr < a->base || (char *)ptr >= __atomic_load_n(&a->next, __ATOMIC_ACQUIRE))
+	{
+		return NULL;
+	}
+
+	return a;
+}
+
+//Return the arena holding the live headed block that starts at ptr, or
+//NULL if no such block starts there. The caller holds arena_lock
+static arena *owner_of(void *ptr)
+{
+	arena *a = arena_at(ptr);
+	size_t bit;
+
+	if (a == NULL || a->kind == ARENA_KIND_SLABS || ((uintptr_t)ptr & (ARENA_GRANULE - 1)) != 0)
+	{
+		return NULL;
+	}
+
+	bit = start_bit(a, ptr);
+
+	return ((a->starts[bit / 64] >> (bit % 64)) & 1) ? a : NULL;
+}
+
+//Fill in and return the record of a live slab object
+static node *slab_record(slab *s, long slot)
+{
+	slab_rec.addr = slab_object(s, slot);
+	slab_rec.length = s->lengths[slot];
+	slab_rec.free_flag = 0;
+	slab_rec.site = 0;
+
+	return &slab_rec;
+}
+
+//Return the slab of the live slab object starting at ptr and set slot to
+//its slot, or return NULL if no slab object starts there
+static slab *slab_owner(void *ptr, long *slot)
+{
+	slab *s;
+
+	if (slabs_at(ptr) == NULL)
+	{
+		return NULL;
+	}
+
+	s = SLAB_OF(ptr);
+	*slot = slab_slot(s, ptr);
+
+	return *slot < 0 ? NULL : s;
+}
+
+//Hand an exited thread's cache over to the threads still running
+static void cache_abandon(void *arg)
+{
+	arena_cache *c = arg;
+
+	pthread_mutex_lock(&arena_lock);
+	c->next = abandoned;
+	abandoned = c;
+	pthread_mutex_unlock(&arena_lock);
+
+	cache = NULL;
+}
+
+static void cache_key_create()
+{
+	pthread_key_create(&cache_key, cache_abandon);
+}
+
+//Return the calling thread's cache, taking over an abandoned one or making
+//a new one on its first allocation, or NULL if out of memory
+static arena_cache *cache_get()
+{
+	if (cache != NULL)
+	{
+		return cache;
+	}
+
+	pthread_once(&cache_once, cache_key_create);
+
+	pthread_mutex_lock(&arena_lock);
+	if (abandoned != NULL)
+	{
+		cache = abandoned;
+		abandoned = cache->next;
+	}
+	else
+	{
+		cache = pool_calloc(&cache_pool);
+	}
+	pthread_mutex_unlock(&arena_lock);
+
+	if (cache != NULL)
+	{
+		pthread_setspecific(cache_key, cache);
+	}
+
+	return cache;
+}
+
+//Release an object of a slab owned by the calling thread's cache
+static void slab_put(arena_cache *c, slab *s, long slot)
+{
+	size_t class_size;
+	int cls;
+
+	slab_release(s, slot);
+	__atomic_fetch_sub(&live_count, 1, __ATOMIC_RELAXED);
+
+	//The slab has room again, put it back on its class list
+	if (!s->partial)
+	{
+		cls = size_class(s->size, &class_size);
+		s->next = c->partial[cls];
+		s->partial = 1;
+		c->partial[cls] = s;
+	}
+}
+
+//Give an object freed by another thread back to the cache owning its slab
+static void remote_push(arena_cache *c, void *ptr)
+{
+	void *head = __atomic_load_n(&c->remote, __ATOMIC_RELAXED);
+
+	do
+	{
+		*(void **)ptr = head;
+	} while (!__atomic_compare_exchange_n(&c->remote, &head, ptr, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+//Release every object other threads have given back to the cache
+static void remote_drain(arena_cache *c)
+{
+	void *ptr = __atomic_exchange_n(&c->remote, NULL, __ATOMIC_ACQUIRE);
+
+	while (ptr != NULL)
+	{
+		void *next = *(void **)ptr;
+		slab *s = SLAB_OF(ptr);
+
+		slab_put(c, s, ((char *)ptr - s->objects) / s->size);
+		ptr = next;
+	}
+}
+
+//Carve a new slab for objects of class_size bytes owned by the cache
+//Return the slab, or NULL if out of memory
+static slab *slab_carve(arena_cache *c, size_t class_size)
+{
+	slab *s = NULL;
+
+	pthread_mutex_lock(&arena_lock);
+	if (current_slabs == NULL || current_slabs->next == current_slabs->end)
+	{
+		current_slabs = arena_map(ARENA_BYTES, ARENA_KIND_SLABS);
+	}
+
+	if (current_slabs != NULL)
+	{
+		s = slab_init(current_slabs->next, class_size);
+		s->owner = c;
+
+		//Lock free lookups see the slab once it is laid out
+		__atomic_store_n(&current_slabs->next, current_slabs->next + SLAB_BYTES, __ATOMIC_RELEASE);
+	}
+	pthread_mutex_unlock(&arena_lock);
+
+	return s;
+}
+
+//Take an object of size bytes from one of the calling thread's slabs of its
+//class, carving a new slab if every one of them is full
+//Return the object's record, or NULL if out of memory
+static node *slab_alloc(size_t size)
+{
+	size_t class_size;
+	int cls = size_class(size, &class_size);
+	arena_cache *c = cache_get();
+	slab *s;
+	long slot;
+
+	if (c == NULL)
+	{
+		return NULL;
+	}
+
+	if (__atomic_load_n(&c->remote, __ATOMIC_RELAXED) != NULL)
+	{
+		remote_drain(c);
+	}
+
+	s = c->partial[cls];
+	if (s == NULL)
+	{
+		s = slab_carve(c, class_size);
+		if (s == NULL)
+		{
+			return NULL;
+		}
+
+		s->partial = 1;
+		c->partial[cls] = s;
+	}
+
+	slot = slab_take(s, size);
+
+	//A full slab leaves the class list until an object is freed
+	if (s->live == s->count)
+	{
+		c->partial[cls] = s->next;
+		s->next = NULL;
+		s->partial = 0;
+	}
+
+	__atomic_fetch_add(&live_count, 1, __ATOMIC_RELAXED);
+
+	return slab_record(s, slot);
+}
+
+//Allocate a block of size bytes
+//Return the block's record, whose addr is the block, or NULL if out of memory
+node *arena_alloc(size_t size)
+{
+	arena_header *hdr;
+	arena *a;
+	size_t class_size;
+	size_t bit;
+
+	//Small objects live in slabs, without a header
+	if (size <= SLAB_MAX)
+	{
+		return slab_alloc(size);
+	}
+
+	pthread_mutex_lock(&arena_lock);
+	if (size > ARENA_LARGE)
+	{
+		//A large block gets a span of its own
+		class_size = (size + ARENA_GRANULE - 1) & ~(ARENA_GRANULE - 1);
+		a = arena_map(sizeof(arena_header) + class_size, ARENA_KIND_SPAN);
+		if (a == NULL)
+		{
+			pthread_mutex_unlock(&arena_lock);
+			return NULL;
+		}
+
+		hdr = (arena_header *)a->base;
+		a->next = a->end;
+	}
+	else
+	{
+		int cls = size_class(size, &class_size);
+
+		hdr = bins[cls];
+		if (hdr != NULL)
+		{
+			//Reuse a freed block of the same class
+			bins[cls] = *(arena_header **)(hdr + 1);
+			a = arenas[arena_below(hdr)];
+		}
+		else
+		{
+			//Carve a new block, starting a new arena if this one is full
+			if (current == NULL || (size_t)(current->end - current->next) < sizeof(arena_header) + class_size)
+			{
+				current = arena_map(ARENA_BYTES, ARENA_KIND_BLOCKS);
+				if (current == NULL)
+				{
+					pthread_mutex_unlock(&arena_lock);
+					return NULL;
+				}
+			}
+
+			a = current;
+			hdr = (arena_header *)a->next;
+			a->next += sizeof(arena_header) + class_size;
+		}
+	}
+
+	hdr->rec.addr = hdr + 1;
+	hdr->rec.length = size;
+	hdr->rec.free_flag = 0;
+	hdr->rec.site = 0;
+	hdr->size = class_size;
+
+	bit = start_bit(a, hdr->rec.addr);
+	a->starts[bit / 64] |= 1ULL << (bit % 64);
+	__atomic_fetch_add(&live_count, 1, __ATOMIC_RELAXED);
+	pthread_mutex_unlock(&arena_lock);
+
+	return &hdr->rec;
+}
+
+//Free the live block starting at ptr. Anything else is ignored
+//A slab object freed by a thread other than its slab's owner is marked
+//pending and queued for the owner, without taking the lock
+void arena_free(void *ptr)
+{
+	arena_header *hdr = (arena_header *)ptr - 1;
+	size_t class_size, bit;
+	arena_cache *c;
+	long slot;
+	slab *s;
+	arena *a;
+	int cls;
+
+	s = slab_owner(ptr, &slot);
+	if (s != NULL)
+	{
+		c = cache_get();
+		if (s->owner == c)
+		{
+			slab_put(c, s, slot);
+		}
+		else if (slab_mark_pending(s, slot) == 0)
+		{
+			remote_push(s->owner, ptr);
+		}
+		return;
+	}
+
+	pthread_mutex_lock(&arena_lock);
+	a = owner_of(ptr);
+	if (a == NULL)
+	{
+		pthread_mutex_unlock(&arena_lock);
+		return;
+	}
+
+	bit = start_bit(a, ptr);
+	a->starts[bit / 64] &= ~(1ULL << (bit % 64));
+	hdr->rec.free_flag = 1;
+	__atomic_fetch_sub(&live_count, 1, __ATOMIC_RELAXED);
+
+	if (a->kind == ARENA_KIND_SPAN)
+	{
+		arena_unmap(a);
+	}
+	else
+	{
+		cls = size_class(hdr->size, &class_size);
+		*(arena_header **)(hdr + 1) = bins[cls];
+		bins[cls] = hdr;
+	}
+	pthread_mutex_unlock(&arena_lock);
+}
+
+//Resize the live block starting at ptr in place
+//Return 0 if it now holds size bytes, -1 if it would have to move
+int arena_resize(void *ptr, size_t size)
+{
+	arena_header *hdr = (arena_header *)ptr - 1;
+	int result = -1;
+	long slot;
+	slab *s;
+
+	s = slab_owner(ptr, &slot);
+	if (s != NULL)
+	{
+		if (size > s->size)
+		{
+			return -1;
+		}
+
+		s->lengths[slot] = (uint16_t)size;
+		return 0;
+	}
+
+	pthread_mutex_lock(&arena_lock);
+	if (owner_of(ptr) != NULL && size <= hdr->size)
+	{
+		hdr->rec.length = size;
+		result = 0;
+	}
+	pthread_mutex_unlock(&arena_lock);
+
+	return result;
+}
+
+//Return the record of the live block starting at ptr, read from its
+//header or its slab, or NULL if no live block starts there
+node *arena_find(void *ptr)
+{
+	node *found = NULL;
+	long slot;
+	slab *s;
+
+	s = slab_owner(ptr, &slot);
+	if (s != NULL)
+	{
+		return slab_record(s, slot);
+	}
+
+	//Slab arenas hold no headed blocks
+	if (slabs_at(ptr) != NULL)
+	{
+		return NULL;
+	}
+
+	pthread_mutex_lock(&arena_lock);
+	if (owner_of(ptr) != NULL)
+	{
+		found = &((arena_header *)ptr - 1)->rec;
+	}
+	pthread_mutex_unlock(&arena_lock);
+
+	return found;
+}
+
+//Return 1 if ptr is inside a slab, 0 otherwise. Slab objects are found by
+//address arithmetic, so they have no record that could be shadowed
+int arena_is_slab(void *ptr)
+{
+	return slabs_at(ptr) != NULL;
+}
+
+//Return the record of the live slab object with the greatest start below
+//ptr in the given slab arena, or NULL if there is none
+static node *slabs_find_GLT(arena *a, void *ptr)
+{
+	char *top = ((char *)ptr >= a->next) ? a->next - SLAB_BYTES : (char *)SLAB_OF(ptr);
+
+	for (slab *s = (slab *)top; (char *)s >= a->base; s = (slab *)((char *)s - SLAB_BYTES))
+	{
+		long slot = slab_live_below(s, slab_index(s, ptr));
+
+		if (slot >= 0)
+		{
+			return slab_record(s, slot);
+		}
+	}
+
+	return NULL;
+}
+
+//Visit the live objects of a slab arena in address order from the first one
+//that does not start below from. Return nonzero if visit stopped the walk
+static int slabs_walk(arena *a, void *from, tree_visit_f visit, void *arg)
+{
+	char *first = ((char *)from <= a->base) ? a->base : (char *)SLAB_OF(from);
+
+	for (slab *s = (slab *)first; (char *)s < a->next; s = (slab *)((char *)s + SLAB_BYTES))
+	{
+		long slot;
+
+		for (slot = slab_live_from(s, slab_index(s, from)); slot >= 0; slot = slab_live_from(s, slot + 1))
+		{
+			if (visit(slab_record(s, slot), arg))
+			{
+				return 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+//Return the record of the live block with the greatest start below ptr,
+//or NULL if there is none. The caller holds arena_lock
+static node *find_GLT_locked(void *ptr)
+{
+	for (int i = arena_below(ptr); i >= 0; i--)
+	{
+		arena *a = arenas[i];
+		size_t limit;
+		long bit;
+
+		//Only starts below ptr count
+		if ((char *)ptr <= a->base || a->next == a->base)
+		{
+			continue;
+		}
+
+		if (a->kind == ARENA_KIND_SLABS)
+		{
+			node *found = slabs_find_GLT(a, ptr);
+
+			if (found != NULL)
+			{
+				return found;
+			}
+			continue;
+		}
+
+		limit = ((char *)ptr >= a->next) ? start_bit(a, a->next)
+										 : (size_t)((char *)ptr - a->base + ARENA_GRANULE - 1) >> ARENA_GRANULE_SHIFT;
+
+		bit = bitmap_last_below(a->starts, limit);
+		if (bit >= 0)
+		{
+			return &header_at(a, bit)->rec;
+		}
+	}
+
+	return NULL;
+}
+
+//Return the record of the live block with the greatest start below ptr,
+//or NULL if there is none. A pointer inside a live slab object is placed
+//by address arithmetic and its slab's bitmap, without the lock
+node *arena_find_GLT(void *ptr)
+{
+	node *found;
+	long slot;
+
+	if (slabs_at(ptr) != NULL)
+	{
+		slot = slab_slot_inside(SLAB_OF(ptr), ptr);
+		if (slot >= 0)
+		{
+			return slab_record(SLAB_OF(ptr), slot);
+		}
+	}
+
+	pthread_mutex_lock(&arena_lock);
+	found = find_GLT_locked(ptr);
+	pthread_mutex_unlock(&arena_lock);
+
+	return found;
+}
+
+//Visit the live blocks in address order, starting at the first block that
+//does not start below from, until visit returns nonzero. The caller holds
+//arena_lock
+static void walk_locked(void *from, tree_visit_f visit, void *arg)
+{
+	int i = arena_below(from);
+
+	for (i = (i < 0) ? 0 : i; i < arena_count; i++)
+	{
+		arena *a = arenas[i];
+		size_t bit = 0;
+		long found;
+
+		if (a->kind == ARENA_KIND_SLABS)
+		{
+			if (slabs_walk(a, from, visit, arg))
+			{
+				return;
+			}
+			continue;
+		}
+
+		if ((char *)from > a->base)
+		{
+			bit = (size_t)((char *)from - a->base + ARENA_GRANULE - 1) >> ARENA_GRANULE_SHIFT;
+		}
+
+		while ((found = bitmap_first_from(a->starts, bit, start_bit(a, a->next))) >= 0)
+		{
+			if (visit(&header_at(a, found)->rec, arg))
+			{
+				return;
+			}
+			bit = found + 1;
+		}
+	}
+}
+
+//Visit the live blocks in address order, starting at the first block that
+//does not start below from, until visit returns nonzero
+void arena_walk(void *from, tree_visit_f visit, void *arg)
+{
+	pthread_mutex_lock(&arena_lock);
+	walk_locked(from, visit, arg);
+	pthread_mutex_unlock(&arena_lock);
+}
+
+//find_GLT_locked and walk_locked in the form tree_find_overlapping_in
+//takes. The arenas are the set, so set is unused
+static node *blocks_glt(void *set, void *addr)
+{
+	(void)set;
+	return find_GLT_locked(addr);
+}
+
+static void blocks_walk(void *set, void *from, tree_visit_f visit, void *arg)
+{
+	(void)set;
+	walk_locked(from, visit, arg);
+}
+
+//Visit, in address order, every live block that intersects [lo, hi),
+//until visit returns nonzero
+void arena_find_overlapping(void *lo, void *hi, tree_visit_f visit, void *arg)
+{
+	pthread_mutex_lock(&arena_lock);
+	tree_find_overlapping_in(NULL, blocks_glt, blocks_walk, lo, hi, visit, arg);
+	pthread_mutex_unlock(&arena_lock);
+}
+
+//Return the number of live blocks
+size_t arena_live_count()
+{
+	return __atomic_load_n(&live_count, __ATOMIC_RELAXED);
+}
+
+//Return the number of bytes mapped for arenas and spans
+size_t arena_mapped_bytes()
+{
+	return __atomic_load_n(&mapped_bytes, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,64 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "range_tree.h"
+
+//Bytes reserved by each arena, a power of two
+#define ARENA_SHIFT 26
+#define ARENA_BYTES (1UL << ARENA_SHIFT)
+
+//Slab arenas are aligned to ARENA_BYTES and found through a table with one
+//entry per ARENA_BYTES of the 48 bit address space
+#define ARENA_REGIONS (1UL << (48 - ARENA_SHIFT))
+
+//Blocks are aligned to and sized in granules of 16 bytes, like malloc's
+#define ARENA_GRANULE_SHIFT 4
+#define ARENA_GRANULE (1UL << ARENA_GRANULE_SHIFT)
+
+//Largest block size with a 16 byte step, larger sizes have 4 classes per
+//power of two. Blocks up to this size are slab objects (slab.c)
+#define ARENA_SMALL_MAX 1024
+
+//Blocks larger than this get a span of their own, unmapped when freed
+#define ARENA_LARGE (ARENA_BYTES / 4)
+
+//Size classes, enough for every block below ARENA_LARGE
+#define ARENA_CLASSES 128
+
+//Most arenas and large spans that can be live at once
+#define ARENA_MAX 4096
+
+//Header in front of every block. rec is a tree node describing the block,
+//so the block can be handed around as the node a tree would have stored.
+//Its size is a whole number of granules, so blocks stay on granule bounds
+typedef struct arena_header
+{
+	node rec;
+	size_t size;
+
+} __attribute__((aligned(ARENA_GRANULE))) arena_header;
+
+//Arena Functions
+node *arena_alloc(size_t size);
+
+void arena_free(void *ptr);
+
+int arena_resize(void *ptr, size_t size);
+
+node *arena_find(void *ptr);
+
+int arena_is_slab(void *ptr);
+
+node *arena_find_GLT(void *ptr);
+
+void arena_walk(void *from, tree_visit_f visit, void *arg);
+
+void arena_find_overlapping(void *lo, void *hi, tree_visit_f visit, void *arg);
+
+size_t arena_live_count();
+
+size_t arena_mapped_bytes();
+
+#endif
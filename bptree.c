@@ -0,0 +1,848 @@
+#include "bptree.h"
+#include "pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BP_X86 1
+#endif
+
+#ifndef BP_HEIGHT_LIMIT
+#define BP_HEIGHT_LIMIT 16    /* Tallest allowable tree */
+#endif
+
+#define BP_MIN (BP_ORDER / 2 - 1) /* Fewest keys in a non-root node */
+#define BP_EMPTY UINTPTR_MAX      /* Key held by unused slots */
+
+/*
+  Leaves and internal nodes share one layout. Keys sit contiguously at
+  the start of the node, which is cache line aligned, and unused key
+  slots hold BP_EMPTY so a node can be searched without looking at count
+*/
+typedef struct bp_node
+{
+  uintptr_t keys[BP_ORDER];       /* Sorted keys */
+  void *slots[BP_ORDER + 1];      /* Children (internal) or items (leaf) */
+  struct bp_node *next;           /* Next leaf in key order */
+  struct bp_node *prev;           /* Previous leaf in key order */
+  int count;                      /* Number of keys in use */
+  int leaf;                       /* 1 for a leaf, 0 for an internal node */
+} __attribute__((aligned(64))) bp_node_t;
+
+struct bp_tree
+{
+  bp_node_t *root;    /* Top of the tree */
+  size_t size;        /* Number of items */
+  size_t data_size;   /* Bytes copied into each item */
+  pool nodes;         /* Node storage */
+  pool items;         /* Item storage */
+};
+
+struct bp_trav
+{
+  bp_node_t *leaf;    /* Current leaf */
+  int index;          /* Current slot in the leaf */
+};
+
+/* Tree headers and traversal objects come from pools, not the heap */
+static pool tree_pool = POOL_INITIALIZER(sizeof(bp_tree_t));
+static pool trav_pool = POOL_INITIALIZER(sizeof(bp_trav_t));
+
+/**
+  <summary>
+  Counts the keys of a node that are less than the given key,
+  one slot at a time
+  <summary>
+  <param name="keys">The full key array of a node</param>
+  <param name="key">The key to rank</param>
+  <returns>The number of keys less than key</returns>
+  <remarks>
+  For bptree.c internal use only. Unused slots hold BP_EMPTY and
+  never count
+  </remarks>
+*/
+static int key_rank_scalar(const uintptr_t *keys, uintptr_t key)
+{
+  int rank = 0;
+
+  /* Branch free so the compiler can vectorize it */
+  for (int i = 0; i < BP_ORDER; i++)
+    rank += keys[i] < key;
+
+  return rank;
+}
+
+#ifdef BP_X86
+/**
+  <summary>
+  Counts the keys of a node that are less than the given key,
+  four slots at a time with AVX2
+  <summary>
+  <param name="keys">The full key array of a node</param>
+  <param name="key">The key to rank</param>
+  <returns>The number of keys less than key</returns>
+  <remarks>
+  For bptree.c internal use only. Compiled for AVX2 whatever the
+  build flags, and only called when the CPU supports it
+  </remarks>
+*/
+__attribute__((target("avx2")))
+static int key_rank_avx2(const uintptr_t *keys, uintptr_t key)
+{
+  int rank = 0;
+
+  /* Flip the sign bits so the signed compare orders addresses */
+  const __m256i bias = _mm256_set1_epi64x(INT64_MIN);
+  __m256i k = _mm256_xor_si256(_mm256_set1_epi64x((long long)key), bias);
+
+  for (int i = 0; i < BP_ORDER; i += 4)
+  {
+    __m256i v = _mm256_xor_si256(_mm256_load_si256((const __m256i *)(keys + i)), bias);
+    __m256i lt = _mm256_cmpgt_epi64(k, v);
+
+    rank += __builtin_popcount(_mm256_movemask_pd(_mm256_castsi256_pd(lt)));
+  }
+
+  return rank;
+}
+#endif
+
+/* The rank kernel for this CPU, chosen when the first tree is made */
+static int (*key_rank_fn)(const uintptr_t *keys, uintptr_t key) = key_rank_scalar;
+static pthread_once_t key_rank_once = PTHREAD_ONCE_INIT;
+
+/**
+  <summary>
+  Picks the widest rank kernel the CPU supports
+  <summary>
+  <remarks>For bptree.c internal use only, run once by bp_new</remarks>
+*/
+static void key_rank_select(void)
+{
+#ifdef BP_X86
+  __builtin_cpu_init();
+
+  if (__builtin_cpu_supports("avx2"))
+    key_rank_fn = key_rank_avx2;
+#endif
+}
+
+/**
+  <summary>
+  Counts the keys of a node that are less than the given key,
+  which is the index of the first key not less than it
+  <summary>
+  <param name="keys">The full key array of a node</param>
+  <param name="key">The key to rank</param>
+  <returns>The number of keys less than key</returns>
+  <remarks>
+  For bptree.c internal use only. Compares every slot with SIMD
+  when the CPU supports it; unused slots hold BP_EMPTY and never count
+  </remarks>
+*/
+static int key_rank(const uintptr_t *keys, uintptr_t key)
+{
+  return key_rank_fn(keys, key);
+}
+
+/**
+  <summary>
+  Picks the child of an internal node whose subtree holds the key
+  <summary>
+  <param name="node">The internal node</param>
+  <param name="key">The key being searched for</param>
+  <returns>The index of the child, the number of keys not above key</returns>
+  <remarks>For bptree.c internal use only</remarks>
+*/
+static int child_index(bp_node_t *node, uintptr_t key)
+{
+  return key == BP_EMPTY ? node->count : key_rank(node->keys, key + 1);
+}
+
+/**
+  <summary>
+  Creates an empty node
+  <summary>
+  <param name="tree">The tree this node is being created for</param>
+  <param name="leaf">1 to create a leaf, 0 for an internal node</param>
+  <returns>A pointer to the new node, or NULL</returns>
+  <remarks>For bptree.c internal use only</remarks>
+*/
+static bp_node_t *new_bnode(bp_tree_t *tree, int leaf)
+{
+  bp_node_t *node = (bp_node_t *)pool_alloc(&tree->nodes);
+
+  if (node == NULL)
+    return NULL;
+
+  for (int i = 0; i < BP_ORDER; i++)
+    node->keys[i] = BP_EMPTY;
+
+  memset(node->slots, 0, sizeof node->slots);
+  node->next = node->prev = NULL;
+  node->count = 0;
+  node->leaf = leaf;
+
+  return node;
+}
+
+/**
+  <summary>
+  Descends from the root to the leaf that holds or would hold a key
+  <summary>
+  <param name="tree">The tree to search</param>
+  <param name="key">The key to search for</param>
+  <param name="path">Receives the internal nodes on the way down</param>
+  <param name="idx">Receives the child taken at each internal node</param>
+  <param name="depth">Receives the number of internal nodes visited</param>
+  <returns>The leaf, or NULL for an empty tree</returns>
+  <remarks>For bptree.c internal use only. path and idx may be NULL</remarks>
+*/
+static bp_node_t *find_leaf(bp_tree_t *tree, uintptr_t key,
+                            bp_node_t **path, int *idx, int *depth)
+{
+  bp_node_t *node = tree->root;
+  int d = 0;
+
+  while (node != NULL && !node->leaf)
+  {
+    int i = child_index(node, key);
+
+    if (path != NULL)
+    {
+      path[d] = node;
+      idx[d] = i;
+    }
+
+    d++;
+    node = (bp_node_t *)node->slots[i];
+  }
+
+  if (depth != NULL)
+    *depth = d;
+
+  return node;
+}
+
+/**
+  <summary>
+  Creates and initializes an empty B+ tree. Items are
+  copies of user data, found by an unsigned integer key
+  <summary>
+  <param name="data_size">Size in bytes of one item</param>
+  <returns>A pointer to the new tree</returns>
+  <remarks>
+  The returned pointer must be released with bp_delete. Item
+  pointers returned by the tree stay valid until that item is erased
+  </remarks>
+*/
+bp_tree_t *bp_new(size_t data_size)
+{
+  bp_tree_t *rtn_tree;
+
+  /* Searches only reach nodes of trees made here */
+  pthread_once(&key_rank_once, key_rank_select);
+
+  rtn_tree = (bp_tree_t *)pool_alloc(&tree_pool);
+  if (rtn_tree == NULL)
+    return NULL;
+
+  rtn_tree->root = NULL;
+  rtn_tree->size = 0;
+  rtn_tree->data_size = data_size;
+  pool_init(&rtn_tree->nodes, sizeof(bp_node_t));
+  pool_init(&rtn_tree->items, data_size);
+
+  return rtn_tree;
+}
+
+/**
+  <summary>
+  Releases a valid B+ tree and all of its items
+  <summary>
+  <param name="tree">The tree to release</param>
+  <remarks>
+  The tree must have been created using bp_new
+  </remarks>
+*/
+void bp_delete(bp_tree_t *tree)
+{
+  pool_destroy(&tree->nodes);
+  pool_destroy(&tree->items);
+  pool_free(&tree_pool, tree);
+}
+
+/**
+  <summary>
+  Search for the item with the specified key
+  <summary>
+  <param name="tree">The tree to search</param>
+  <param name="key">The key to search for</param>
+  <returns>
+  A pointer to the item stored in the tree,
+  or a null pointer if no item has that key
+  </returns>
+*/
+void *bp_find(bp_tree_t *tree, uintptr_t key)
+{
+  bp_node_t *leaf = find_leaf(tree, key, NULL, NULL, NULL);
+  int i;
+
+  if (leaf == NULL)
+    return NULL;
+
+  i = key_rank(leaf->keys, key);
+
+  return (i < leaf->count && leaf->keys[i] == key) ? leaf->slots[i] : NULL;
+}
+
+/**
+  <summary>
+  Search for the item with the greatest key less than the specified key
+  <summary>
+  <param name="tree">The tree to search</param>
+  <param name="key">The key to search below</param>
+  <param name="next">
+  If not null, receives the item with the smallest key not less than key,
+  or a null pointer if there is none
+  </param>
+  <returns>
+  A pointer to the item stored in the tree,
+  or a null pointer if every key is at least key
+  </returns>
+*/
+void *bp_find_GLT(bp_tree_t *tree, uintptr_t key, void **next)
+{
+  bp_node_t *leaf = find_leaf(tree, key, NULL, NULL, NULL);
+  int i;
+
+  if (next != NULL)
+    *next = NULL;
+
+  if (leaf == NULL)
+    return NULL;
+
+  i = key_rank(leaf->keys, key);
+  if (next != NULL)
+  {
+    /* The successor is in this leaf or starts the next one */
+    if (i < leaf->count)
+      *next = leaf->slots[i];
+    else if (leaf->next != NULL)
+      *next = leaf->next->slots[0];
+  }
+
+  if (i > 0)
+    return leaf->slots[i - 1];
+
+  /* Every key in this leaf is too large, the answer ends the previous one */
+  leaf = leaf->prev;
+
+  return leaf == NULL ? NULL : leaf->slots[leaf->count - 1];
+}
+
+/**
+  <summary>
+  Moves the upper half of a full leaf into a new leaf on its right
+  <summary>
+  <param name="tree">The tree the leaf belongs to</param>
+  <param name="leaf">The full leaf</param>
+  <returns>The new right leaf, or NULL</returns>
+  <remarks>For bptree.c internal use only</remarks>
+*/
+static bp_node_t *split_leaf(bp_tree_t *tree, bp_node_t *leaf)
+{
+  bp_node_t *right = new_bnode(tree, 1);
+  int half = BP_ORDER / 2;
+
+  if (right == NULL)
+    return NULL;
+
+  right->count = leaf->count - half;
+  memcpy(right->keys, leaf->keys + half, right->count * sizeof(uintptr_t));
+  memcpy(right->slots, leaf->slots + half, right->count * sizeof(void *));
+
+  for (int i = half; i < leaf->count; i++)
+  {
+    leaf->keys[i] = BP_EMPTY;
+    leaf->slots[i] = NULL;
+  }
+  leaf->count = half;
+
+  /* Link the new leaf into the leaf chain */
+  right->next = leaf->next;
+  right->prev = leaf;
+  if (right->next != NULL)
+    right->next->prev = right;
+  leaf->next = right;
+
+  return right;
+}
+
+/**
+  <summary>
+  Inserts a key and the child to its right into an internal node with room
+  <summary>
+  <param name="node">The internal node</param>
+  <param name="pos">The index of the key, one less than the child's</param>
+  <param name="key">The separator key</param>
+  <param name="child">The child holding keys from key upward</param>
+  <remarks>For bptree.c internal use only</remarks>
+*/
+static void internal_insert_at(bp_node_t *node, int pos, uintptr_t key, bp_node_t *child)
+{
+  memmove(node->keys + pos + 1, node->keys + pos, (node->count - pos) * sizeof(uintptr_t));
+  memmove(node->slots + pos + 2, node->slots + pos + 1, (node->count - pos) * sizeof(void *));
+
+  node->keys[pos] = key;
+  node->slots[pos + 1] = child;
+  node->count++;
+}
+
+/**
+  <summary>
+  Links a node created by a split into the tree, splitting
+  full ancestors and growing a new root as needed
+  <summary>
+  <param name="tree">The tree being inserted into</param>
+  <param name="path">The internal nodes above the split node</param>
+  <param name="idx">The child taken at each node of path</param>
+  <param name="depth">The number of nodes in path</param>
+  <param name="left">The node that was split</param>
+  <param name="sep">The smallest key of the right node</param>
+  <param name="right">The node created by the split</param>
+  <returns>1 on success, 0 if a node could not be allocated</returns>
+  <remarks>For bptree.c internal use only</remarks>
+*/
+static int insert_parent(bp_tree_t *tree, bp_node_t **path, int *idx, int depth,
+                         bp_node_t *left, uintptr_t sep, bp_node_t *right)
+{
+  while (depth > 0)
+  {
+    bp_node_t *parent = path[depth - 1];
+    int pos = idx[depth - 1];
+    int half = BP_ORDER / 2;
+    bp_node_t *split;
+    uintptr_t up;
+
+    if (parent->count < BP_ORDER)
+    {
+      internal_insert_at(parent, pos, sep, right);
+      return 1;
+    }
+
+    /* Split the full parent around its middle key, which moves up */
+    split = new_bnode(tree, 0);
+    if (split == NULL)
+      return 0;
+
+    up = parent->keys[half];
+    split->count = BP_ORDER - half - 1;
+    memcpy(split->keys, parent->keys + half + 1, split->count * sizeof(uintptr_t));
+    memcpy(split->slots, parent->slots + half + 1, (split->count + 1) * sizeof(void *));
+
+    for (int i = half; i < BP_ORDER; i++)
+    {
+      parent->keys[i] = BP_EMPTY;
+      parent->slots[i + 1] = NULL;
+    }
+    parent->count = half;
+
+    /* Then add the pending separator to whichever half holds left */
+    if (pos <= half)
+      internal_insert_at(parent, pos, sep, right);
+    else
+      internal_insert_at(split, pos - half - 1, sep, right);
+
+    left = parent;
+    sep = up;
+    right = split;
+    depth--;
+  }
+
+  /* The root was split; grow the tree by one level */
+  bp_node_t *root = new_bnode(tree, 0);
+
+  if (root == NULL)
+    return 0;
+
+  root->keys[0] = sep;
+  root->slots[0] = left;
+  root->slots[1] = right;
+  root->count = 1;
+  tree->root = root;
+
+  return 1;
+}
+
+/**
+  <summary>
+  Insert a copy of the user-specified data into a B+ tree
+  <summary>
+  <param name="tree">The tree to insert into</param>
+  <param name="key">The key of the data</param>
+  <param name="data">The data value to insert</param>
+  <returns>
+  A pointer to the copy stored in the tree,
+  or a null pointer if the insertion failed for any reason
+  </returns>
+  <remarks>
+  A key that is already in the tree is not inserted again
+  </remarks>
+*/
+void *bp_insert_data(bp_tree_t *tree, uintptr_t key, void *data)
+{
+  bp_node_t *path[BP_HEIGHT_LIMIT];
+  int idx[BP_HEIGHT_LIMIT];
+  int depth, i;
+  bp_node_t *leaf;
+  void *item;
+
+  if (key == BP_EMPTY)
+    return NULL;
+
+  if (tree->root == NULL && (tree->root = new_bnode(tree, 1)) == NULL)
+    return NULL;
+
+  leaf = find_leaf(tree, key, path, idx, &depth);
+  i = key_rank(leaf->keys, key);
+
+  if (i < leaf->count && leaf->keys[i] == key)
+    return NULL;
+
+  if (depth == BP_HEIGHT_LIMIT && leaf->count == BP_ORDER)
+    return NULL;
+
+  item = pool_alloc(&tree->items);
+  if (item == NULL)
+    return NULL;
+  memcpy(item, data, tree->data_size);
+
+  if (leaf->count == BP_ORDER)
+  {
+    bp_node_t *right = split_leaf(tree, leaf);
+
+    if (right == NULL || !insert_parent(tree, path, idx, depth, leaf, right->keys[0], right))
+    {
+      pool_free(&tree->items, item);
+      return NULL;
+    }
+
+    if (key >= right->keys[0])
+      leaf = right;
+
+    i = key_rank(leaf->keys, key);
+  }
+
+  memmove(leaf->keys + i + 1, leaf->keys + i, (leaf->count - i) * sizeof(uintptr_t));
+  memmove(leaf->slots + i + 1, leaf->slots + i, (leaf->count - i) * sizeof(void *));
+  leaf->keys[i] = key;
+  leaf->slots[i] = item;
+  leaf->count++;
+
+  ++tree->size;
+
+  return item;
+}
+
+/**
+  <summary>
+  Removes the key at an index of a node, shifting the rest down
+  <summary>
+  <param name="node">The node</param>
+  <param name="pos">The index of the key</param>
+  <param name="slot">The index of the slot removed along with it</param>
+  <remarks>For bptree.c internal use only</remarks>
+*/
+static void remove_at(bp_node_t *node, int pos, int slot)
+{
+  int slots = node->leaf ? node->count : node->count + 1;
+
+  memmove(node->keys + pos, node->keys + pos + 1, (node->count - pos - 1) * sizeof(uintptr_t));
+  memmove(node->slots + slot, node->slots + slot + 1, (slots - slot - 1) * sizeof(void *));
+
+  node->count--;
+  node->keys[node->count] = BP_EMPTY;
+  node->slots[slots - 1] = NULL;
+}
+
+/**
+  <summary>
+  Merges the child right of a separator into the child left of it
+  and removes the separator from the parent
+  <summary>
+  <param name="tree">The tree the nodes belong to</param>
+  <param name="parent">The parent of both children</param>
+  <param name="pos">The index of the separator</param>
+  <remarks>For bptree.c internal use only</remarks>
+*/
+static void merge_children(bp_tree_t *tree, bp_node_t *parent, int pos)
+{
+  bp_node_t *left = (bp_node_t *)parent->slots[pos];
+  bp_node_t *right = (bp_node_t *)parent->slots[pos + 1];
+
+  if (left->leaf)
+  {
+    memcpy(left->keys + left->count, right->keys, right->count * sizeof(uintptr_t));
+    memcpy(left->slots + left->count, right->slots, right->count * sizeof(void *));
+    left->count += right->count;
+
+    left->next = right->next;
+    if (left->next != NULL)
+      left->next->prev = left;
+  }
+  else
+  {
+    /* The separator comes down between the two halves */
+    left->keys[left->count] = parent->keys[pos];
+    memcpy(left->keys + left->count + 1, right->keys, right->count * sizeof(uintptr_t));
+    memcpy(left->slots + left->count + 1, right->slots, (right->count + 1) * sizeof(void *));
+    left->count += right->count + 1;
+  }
+
+  /* Lock free predecessor queries may still be walking it */
+  pool_retire(&tree->nodes, right);
+  remove_at(parent, pos, pos + 1);
+}
+
+/**
+  <summary>
+  Refills an underfull child by borrowing from a sibling,
+  or merges it with a sibling when neither can spare a key
+  <summary>
+  <param name="tree">The tree the nodes belong to</param>
+  <param name="parent">The parent of the underfull child</param>
+  <param name="ci">The index of the underfull child</param>
+  <returns>1 if children were merged, which removes a key from parent</returns>
+  <remarks>For bptree.c internal use only</remarks>
+*/
+static int rebalance(bp_tree_t *tree, bp_node_t *parent, int ci)
+{
+  bp_node_t *node = (bp_node_t *)parent->slots[ci];
+  bp_node_t *left = ci > 0 ? (bp_node_t *)parent->slots[ci - 1] : NULL;
+  bp_node_t *right = ci < parent->count ? (bp_node_t *)parent->slots[ci + 1] : NULL;
+
+  if (left != NULL && left->count > BP_MIN)
+  {
+    /* Take the last key of the left sibling */
+    memmove(node->keys + 1, node->keys, node->count * sizeof(uintptr_t));
+    memmove(node->slots + 1, node->slots, (node->leaf ? node->count : node->count + 1) * sizeof(void *));
+
+    if (node->leaf)
+    {
+      node->keys[0] = left->keys[left->count - 1];
+      node->slots[0] = left->slots[left->count - 1];
+      left->slots[left->count - 1] = NULL;
+      parent->keys[ci - 1] = node->keys[0];
+    }
+    else
+    {
+      node->keys[0] = parent->keys[ci - 1];
+      node->slots[0] = left->slots[left->count];
+      left->slots[left->count] = NULL;
+      parent->keys[ci - 1] = left->keys[left->count - 1];
+    }
+
+    left->keys[left->count - 1] = BP_EMPTY;
+    left->count--;
+    node->count++;
+
+    return 0;
+  }
+
+  if (right != NULL && right->count > BP_MIN)
+  {
+    /* Take the first key of the right sibling */
+    if (node->leaf)
+    {
+      node->keys[node->count] = right->keys[0];
+      node->slots[node->count] = right->slots[0];
+      node->count++;
+      remove_at(right, 0, 0);
+      parent->keys[ci] = right->keys[0];
+    }
+    else
+    {
+      node->keys[node->count] = parent->keys[ci];
+      node->slots[node->count + 1] = right->slots[0];
+      node->count++;
+      parent->keys[ci] = right->keys[0];
+      remove_at(right, 0, 0);
+    }
+
+    return 0;
+  }
+
+  merge_children(tree, parent, left != NULL ? ci - 1 : ci);
+
+  return 1;
+}
+
+/**
+  <summary>
+  Remove the item with the specified key from a B+ tree
+  <summary>
+  <param name="tree">The tree to remove from</param>
+  <param name="key">The key to search for</param>
+  <returns>
+  1 if the item was removed successfully,
+  0 if the key was not found
+  </returns>
+*/
+int bp_erase(bp_tree_t *tree, uintptr_t key)
+{
+  bp_node_t *path[BP_HEIGHT_LIMIT];
+  int idx[BP_HEIGHT_LIMIT];
+  int depth, i;
+  bp_node_t *node = find_leaf(tree, key, path, idx, &depth);
+
+  if (node == NULL)
+    return 0;
+
+  i = key_rank(node->keys, key);
+  if (i >= node->count || node->keys[i] != key)
+    return 0;
+
+  /* Items may still be read by epoch readers */
+  pool_retire(&tree->items, node->slots[i]);
+  remove_at(node, i, i);
+  --tree->size;
+
+  /* Rebalance upward while merges leave nodes underfull */
+  while (depth > 0 && node->count < BP_MIN)
+  {
+    if (!rebalance(tree, path[depth - 1], idx[depth - 1]))
+      break;
+
+    node = path[--depth];
+  }
+
+  /* Shrink the tree when the root runs out of keys */
+  node = tree->root;
+  if (!node->leaf && node->count == 0)
+  {
+    tree->root = (bp_node_t *)node->slots[0];
+    pool_retire(&tree->nodes, node);
+  }
+  else if (node->leaf && node->count == 0)
+  {
+    tree->root = NULL;
+    pool_retire(&tree->nodes, node);
+  }
+
+  return 1;
+}
+
+/**
+  <summary>
+  Gets the number of items in a B+ tree
+  <summary>
+  <param name="tree">The tree to calculate a size for</param>
+  <returns>The number of items in the tree</returns>
+*/
+size_t bp_size(bp_tree_t *tree)
+{
+  return tree->size;
+}
+
+/**
+  <summary>
+  Create a new traversal object
+  <summary>
+  <returns>A pointer to the new object</returns>
+  <remarks>
+  The traversal object is not initialized until bp_tfirst is called.
+  The pointer must be released with bp_tdelete
+  </remarks>
+*/
+bp_trav_t *bp_tnew(void)
+{
+  return (bp_trav_t *)pool_alloc(&trav_pool);
+}
+
+/**
+  <summary>
+  Release a traversal object
+  <summary>
+  <param name="trav">The object to release</param>
+  <remarks>
+  The object must have been created with bp_tnew
+  </remarks>
+*/
+void bp_tdelete(bp_trav_t *trav)
+{
+  pool_free(&trav_pool, trav);
+}
+
+/**
+  <summary>
+  Initialize a traversal object to the smallest key
+  <summary>
+  <param name="trav">The traversal object to initialize</param>
+  <param name="tree">The tree that the object will be attached to</param>
+  <returns>A pointer to the item with the smallest key</returns>
+*/
+void *bp_tfirst(bp_trav_t *trav, bp_tree_t *tree)
+{
+  bp_node_t *node = tree->root;
+
+  while (node != NULL && !node->leaf)
+    node = (bp_node_t *)node->slots[0];
+
+  trav->leaf = node;
+  trav->index = 0;
+
+  return (node == NULL || node->count == 0) ? NULL : node->slots[0];
+}
+
+/**
+  <summary>
+  Initialize a traversal object to the smallest key
+  that is not less than the specified key
+  <summary>
+  <param name="trav">The traversal object to initialize</param>
+  <param name="tree">The tree that the object will be attached to</param>
+  <param name="key">The key to seek to</param>
+  <returns>A pointer to that item, or NULL if every key is less</returns>
+*/
+void *bp_tseek(bp_trav_t *trav, bp_tree_t *tree, uintptr_t key)
+{
+  bp_node_t *leaf = find_leaf(tree, key, NULL, NULL, NULL);
+
+  trav->leaf = leaf;
+  trav->index = leaf == NULL ? 0 : key_rank(leaf->keys, key);
+
+  /* Every key of this leaf is less, the answer starts the next one */
+  if (leaf != NULL && trav->index >= leaf->count)
+  {
+    trav->leaf = leaf->next;
+    trav->index = 0;
+  }
+
+  return (trav->leaf == NULL || trav->leaf->count == 0) ? NULL : trav->leaf->slots[trav->index];
+}
+
+/**
+  <summary>
+  Traverse to the next item in ascending key order
+  along the leaf chain
+  <summary>
+  <param name="trav">The initialized traversal object</param>
+  <returns>A pointer to the next item in ascending order</returns>
+*/
+void *bp_tnext(bp_trav_t *trav)
+{
+  if (trav->leaf == NULL)
+    return NULL;
+
+  if (++trav->index >= trav->leaf->count)
+  {
+    trav->leaf = trav->leaf->next;
+    trav->index = 0;
+  }
+
+  return trav->leaf == NULL ? NULL : trav->leaf->slots[trav->index];
+}
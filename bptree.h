@@ -0,0 +1,32 @@
+#ifndef BPTREE_H
+#define BPTREE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Keys held by one node; a multiple of 4 so nodes can be searched with SIMD */
+#ifndef BP_ORDER
+#define BP_ORDER 32
+#endif
+
+/* Opaque types */
+typedef struct bp_tree bp_tree_t;
+typedef struct bp_trav bp_trav_t;
+
+/* B+ tree functions */
+bp_tree_t *bp_new ( size_t data_size );
+void       bp_delete ( bp_tree_t *tree );
+void      *bp_find ( bp_tree_t *tree, uintptr_t key );
+void      *bp_find_GLT ( bp_tree_t *tree, uintptr_t key, void **next );
+void      *bp_insert_data ( bp_tree_t *tree, uintptr_t key, void *data );
+int        bp_erase ( bp_tree_t *tree, uintptr_t key );
+size_t     bp_size ( bp_tree_t *tree );
+
+/* Traversal functions */
+bp_trav_t *bp_tnew ( void );
+void       bp_tdelete ( bp_trav_t *trav );
+void      *bp_tfirst ( bp_trav_t *trav, bp_tree_t *tree );
+void      *bp_tseek ( bp_trav_t *trav, bp_tree_t *tree, uintptr_t key );
+void      *bp_tnext ( bp_trav_t *trav );
+
+#endif
@@ -0,0 +1,257 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include "pool.h"
+#include "epoch.h"
+
+//Epoch based reclamation. Readers run between epoch_enter and epoch_exit
+//without locks. Writers unlink an object, then retire it tagged with the
+//global epoch; it is reclaimed once the epoch has moved on twice, because
+//by then every reader that could have seen it has left
+
+//An object waiting for reclamation
+typedef struct retired
+{
+	void *obj;
+	epoch_free_f reclaim;
+	void *arg;
+	unsigned long epoch;
+} retired;
+
+//A thread's reader state and its retired objects. state is 0 outside a
+//read section, otherwise the epoch the thread entered at, shifted left
+//one, with the low bit set
+typedef struct epoch_thread
+{
+	unsigned long state;
+	int depth;
+	int in_use;
+	retired *list;
+	size_t count;
+	size_t capacity;
+	size_t collect_at;
+	struct epoch_thread *next;
+} epoch_thread;
+
+static unsigned long global_epoch = 1;
+
+//Thread records, and the bytes mapped for lists of retired objects. Both
+//stay out of the application's heap
+static pool thread_pool = POOL_INITIALIZER(sizeof(epoch_thread));
+static size_t list_mapped;
+
+//Every thread record ever made. Records of exited threads are reused,
+//with their retired objects, by new threads
+static epoch_thread *threads;
+
+static __thread epoch_thread *self;
+static pthread_key_t self_key;
+static pthread_once_t self_once = PTHREAD_ONCE_INIT;
+
+//Leave a record for the next new thread when its thread exits
+static void self_release(void *arg)
+{
+	epoch_thread *t = arg;
+
+	__atomic_store_n(&t->state, 0, __ATOMIC_RELEASE);
+	t->depth = 0;
+	__atomic_store_n(&t->in_use, 0, __ATOMIC_RELEASE);
+	self = NULL;
+}
+
+static void self_key_create()
+{
+	pthread_key_create(&self_key, self_release);
+}
+
+//Return the calling thread's record, adopting an unused one or registering
+//a new one the first time. Exits if out of memory
+static epoch_thread *self_get()
+{
+	epoch_thread *t;
+
+	if (self != NULL)
+	{
+		return self;
+	}
+
+	pthread_once(&self_once, self_key_create);
+
+	for (t = __atomic_load_n(&threads, __ATOMIC_ACQUIRE); t != NULL; t = t->next)
+	{
+		int unused = 0;
+
+		if (__atomic_compare_exchange_n(&t->in_use, &unused, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		{
+			break;
+		}
+	}
+
+	if (t == NULL)
+	{
+		t = pool_calloc(&thread_pool);
+		if (t == NULL)
+		{
+			fprintf(stderr, "Malloc failed");
+			exit(EXIT_FAILURE);
+		}
+		t->in_use = 1;
+		t->collect_at = EPOCH_BATCH;
+
+		t->next = __atomic_load_n(&threads, __ATOMIC_RELAXED);
+		while (!__atomic_compare_exchange_n(&threads, &t->next, t, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+		{
+		}
+	}
+
+	self = t;
+	pthread_setspecific(self_key, t);
+
+	return t;
+}
+
+//Start a read section. Objects reached inside it stay valid until the
+//matching epoch_exit. Sections nest
+void epoch_enter()
+{
+	epoch_thread *t = self_get();
+
+	if (t->depth++ == 0)
+	{
+		__atomic_store_n(&t->state, (__atomic_load_n(&global_epoch, __ATOMIC_ACQUIRE) << 1) | 1, __ATOMIC_RELAXED);
+
+		//The state must be visible before any shared pointer is read
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	}
+}
+
+//End a read section, reclaiming what the thread retired inside it once
+//enough has piled up
+void epoch_exit()
+{
+	epoch_thread *t = self;
+
+	if (--t->depth == 0)
+	{
+		__atomic_store_n(&t->state, 0, __ATOMIC_RELEASE);
+
+		if (t->count >= t->collect_at)
+		{
+			epoch_collect();
+		}
+	}
+}
+
+//Advance the global epoch if every thread in a read section has seen it
+static void epoch_advance()
+{
+	unsigned long epoch = __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST);
+
+	for (epoch_thread *t = __atomic_load_n(&threads, __ATOMIC_ACQUIRE); t != NULL; t = t->next)
+	{
+		unsigned long state = __atomic_load_n(&t->state, __ATOMIC_SEQ_CST);
+
+		if ((state & 1) && (state >> 1) != epoch)
+		{
+			return;
+		}
+	}
+
+	__atomic_compare_exchange_n(&global_epoch, &epoch, epoch + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+//Try to advance the epoch, then reclaim the calling thread's retired
+//objects that no reader can still hold
+void epoch_collect()
+{
+	epoch_thread *t = self_get();
+	unsigned long epoch;
+	size_t kept = 0;
+
+	epoch_advance();
+	epoch = __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST);
+
+	for (size_t i = 0; i < t->count; i++)
+	{
+		if (t->list[i].epoch + 2 <= epoch)
+		{
+			t->list[i].reclaim(t->list[i].obj, t->list[i].arg);
+		}
+		else
+		{
+			t->list[kept++] = t->list[i];
+		}
+	}
+
+	t->count = kept;
+
+	//Objects still held by readers are only looked at again once more
+	//have been retired
+	t->collect_at = kept + EPOCH_BATCH;
+}
+
+//Wait until every object the calling thread retired has been reclaimed
+//Must not be called inside a read section
+void epoch_synchronize()
+{
+	while (self_get()->count > 0)
+	{
+		epoch_collect();
+		sched_yield();
+	}
+}
+
+//Reclaim obj with reclaim(obj, arg) once no read section can still hold
+//it. The caller must already have made obj unreachable
+void epoch_retire(void *obj, epoch_free_f reclaim, void *arg)
+{
+	epoch_thread *t = self_get();
+
+	//Grow the list into a mapping twice the size
+	if (t->count == t->capacity)
+	{
+		size_t capacity = (t->capacity == 0) ? EPOCH_LIST_BYTES / sizeof(retired) : t->capacity * 2;
+		retired *list = mmap(NULL, capacity * sizeof(retired), PROT_READ | PROT_WRITE,
+							 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+		if (list == MAP_FAILED)
+		{
+			fprintf(stderr, "Malloc failed");
+			exit(EXIT_FAILURE);
+		}
+
+		if (t->list != NULL)
+		{
+			memcpy(list, t->list, t->count * sizeof(retired));
+			munmap(t->list, t->capacity * sizeof(retired));
+		}
+		__atomic_fetch_add(&list_mapped, (capacity - t->capacity) * sizeof(retired), __ATOMIC_RELAXED);
+
+		t->list = list;
+		t->capacity = capacity;
+	}
+
+	//The object was unlinked before the epoch it is tagged with is read
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+	t->list[t->count].obj = obj;
+	t->list[t->count].reclaim = reclaim;
+	t->list[t->count].arg = arg;
+	t->list[t->count].epoch = __atomic_load_n(&global_epoch, __ATOMIC_SEQ_CST);
+	t->count++;
+
+	if (t->count >= t->collect_at && t->depth == 0)
+	{
+		epoch_collect();
+	}
+}
+
+//Return the bytes mapped for lists of retired objects. Thread records come
+//from a pool and are counted with the pools
+size_t epoch_mapped_bytes()
+{
+	return __atomic_load_n(&list_mapped, __ATOMIC_RELAXED);
+}
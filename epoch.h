@@ -0,0 +1,28 @@
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <stddef.h>
+
+//Objects a thread retires before it tries to advance the epoch and reclaim
+#define EPOCH_BATCH 64
+
+//Bytes mapped for a thread's first list of retired objects, a page
+#define EPOCH_LIST_BYTES 4096
+
+//Called to reclaim a retired object once no reader can still hold it
+typedef void (*epoch_free_f)(void *obj, void *arg);
+
+//Epoch Functions
+void epoch_enter();
+
+void epoch_exit();
+
+void epoch_retire(void *obj, epoch_free_f reclaim, void *arg);
+
+void epoch_collect();
+
+void epoch_synchronize();
+
+size_t epoch_mapped_bytes();
+
+#endif
@@ -0,0 +1,24 @@
+#include <stdio.h>
+#include "537malloc.h"
+
+#define SIZE 1000
+
+int main() {
+	malloc537_redzones(1);
+
+	int size = sizeof(int) * SIZE;
+	char *ptr = malloc537(size);
+	printf("Allocated %d bytes @ %p\n", size, ptr);
+
+	printf("Writing one byte past the end of %p\n", ptr);
+	ptr[size] = 0;
+
+	printf("Damaged blocks found by the sweep: %zu\n", memcheck537_redzones());
+
+	printf("Freeing %p : Should fail - Redzone overwritten!\n", ptr);
+	free537(ptr);
+
+	printf("If this prints, no points\n");
+
+	return 0;
+}
@@ -0,0 +1,25 @@
+#include <stdio.h>
+#include "537malloc.h"
+
+#define SIZE 1000
+
+int main() {
+	malloc537_quarantine(sizeof(int) * SIZE * 4);
+
+	int size = sizeof(int) * SIZE;
+	char *ptr = malloc537(size);
+	printf("Allocated %d bytes @ %p\n", size, ptr);
+
+	free537(ptr);
+	printf("Freed %p, writing through the dangling pointer\n", ptr);
+	ptr[size / 2] = 1;
+
+	printf("Allocating and freeing until %p leaves the quarantine : Should fail - Written after free!\n", ptr);
+	for(int i = 0; i < 8; i++) {
+		free537(malloc537(size));
+	}
+
+	printf("If this prints, no points\n");
+
+	return 0;
+}
@@ -11,6 +11,14 @@ using std::size_t;
 #include <stdlib.h>
 #endif
 
+#ifdef __cplusplus
+extern "C" {
+#include "pool.h"
+}
+#else
+#include "pool.h"
+#endif
+
 #ifndef HEIGHT_LIMIT
 #define HEIGHT_LIMIT 64 /* Tallest allowable tree */
 #endif
@@ -40,6 +48,11 @@ struct jsw_rbtrav
   size_t top;                       /* Top of stack */
 };
 
+/* Trees, nodes and traversal objects come from pools, not the heap */
+static pool tree_pool = POOL_INITIALIZER(sizeof(jsw_rbtree_t));
+static pool node_pool = POOL_INITIALIZER(sizeof(jsw_rbnode_t));
+static pool trav_pool = POOL_INITIALIZER(sizeof(jsw_rbtrav_t));
+
 /**
   <summary>
   Checks the color of a red black node
@@ -65,25 +78,17 @@ static int is_red(jsw_rbnode_t *root)
 */
 static jsw_rbnode_t *jsw_single(jsw_rbnode_t *root, int dir)
 {
-  
-  if (root->link != NULL) {
-    jsw_rbnode_t *save = root->link[!dir];
+  jsw_rbnode_t *save = root->link[!dir];
 
   root->link[!dir] = save->link[dir];
   save->link[dir] = root;
 
-
   root->red = 1;
   save->red = 0;
 
   return save;
 }
 
-else {
-  return NULL;
-  }
-}
-
 /**
   <summary>
   Performs a double red black rotation in the specified direction
@@ -96,9 +101,8 @@ else {
 */
 static jsw_rbnode_t *jsw_double(jsw_rbnode_t *root, int dir)
 {
-  if (root->link != NULL) {
-    root->link[!dir] = jsw_single(root->link[!dir], !dir);
-}
+  root->link[!dir] = jsw_single(root->link[!dir], !dir);
+
   return jsw_single(root, dir);
 }
 
@@ -113,12 +117,12 @@ static jsw_rbnode_t *jsw_double(jsw_rbnode_t *root, int dir)
   <remarks>
   For jsw_rbtree.c internal use only. The data for this node must
   be freed using the same tree's rel function. The returned pointer
-  must be freed using C's free function
+  must be released to node_pool
   </remarks>
 */
 static jsw_rbnode_t *new_node(jsw_rbtree_t *tree, void *data)
 {
-  jsw_rbnode_t *rn = (jsw_rbnode_t *)malloc(sizeof *rn);
+  jsw_rbnode_t *rn = (jsw_rbnode_t *)pool_alloc(&node_pool);
 
   if (rn == NULL)
     return NULL;
@@ -145,7 +149,7 @@ static jsw_rbnode_t *new_node(jsw_rbtree_t *tree, void *data)
 */
 jsw_rbtree_t *jsw_rbnew(cmp_f cmp, dup_f dup, rel_f rel)
 {
-  jsw_rbtree_t *rt = (jsw_rbtree_t *)malloc(sizeof *rt);
+  jsw_rbtree_t *rt = (jsw_rbtree_t *)pool_alloc(&tree_pool);
 
   if (rt == NULL)
     return NULL;
@@ -185,7 +189,7 @@ void jsw_rbdelete(jsw_rbtree_t *tree)
       /* No left links, just kill the node and move on */
       save = it->link[1];
       tree->rel(it->data);
-      free(it);
+      pool_free(&node_pool, it);
     }
     else
     {
@@ -198,7 +202,7 @@ void jsw_rbdelete(jsw_rbtree_t *tree)
     it = save;
   }
 
-  free(tree);
+  pool_free(&tree_pool, tree);
 }
 
 /**
@@ -236,44 +240,32 @@ void *jsw_rbfind(jsw_rbtree_t *tree, void *data)
 
 
 //Returns node of tree that is Greatest Less Than the given address
-void *jsw_rbfind_GLT(jsw_rbtree_t *tree, void *data, void* curr_high)
+//If next is not NULL it is set to the smallest node that is not less than
+//the given address, so the caller knows the range the answer holds for
+void *jsw_rbfind_GLT(jsw_rbtree_t *tree, void *data, void **next)
 {
   jsw_rbnode_t *curr = tree->root;
-  int found_highest = 0;
+  void *low = NULL, *high = NULL;
 
+  /* One comparison per level: go right past smaller items, left otherwise */
   while(curr != NULL)
   {
-    if(tree->cmp(curr->data, curr_high) == 1 && (tree->cmp(data, curr->data) == 1))
-    { 
-      
-      curr_high = curr->data;
-      found_highest = 1;
-    }
-
-    if(tree->cmp(curr->data, data) == 1)
+    if(tree->cmp(curr->data, data) < 0)
     {
-      
-      curr = curr->link[0];
+      low = curr->data;
+      curr = curr->link[1];
     }
     else
     {
-      
-      curr = curr->link[1];
+      high = curr->data;
+      curr = curr->link[0];
     }
   }
 
-  if(found_highest == 0)
-  {
-    
-    return NULL;
-  }
-  else
-  {
-    return curr_high;
-  }
-
-
+  if(next != NULL)
+    *next = high;
 
+  return low;
 }
 
 /**
@@ -284,22 +276,27 @@ void *jsw_rbfind_GLT(jsw_rbtree_t *tree, void *data, void* curr_high)
   <param name="tree">The tree to insert into</param>
   <param name="data">The data value to insert</param>
   <returns>
-  1 if the value was inserted successfully,
-  0 if the insertion failed for any reason
+  A pointer to the copy stored in the tree,
+  or a null pointer if the insertion failed for any reason
   </returns>
+  <remarks>
+  Data that compares equal to an item already in the tree is not inserted
+  </remarks>
 */
-int jsw_rbinsert(jsw_rbtree_t *tree, void *data)
+void *jsw_rbinsert_data(jsw_rbtree_t *tree, void *data)
 {
+  jsw_rbnode_t *inserted = NULL;
+
   if (tree->root == NULL)
   {
     /*
       We have an empty tree; attach the
       new node directly to the root
     */
-    tree->root = new_node(tree, data);
+    tree->root = inserted = new_node(tree, data);
 
     if (tree->root == NULL)
-      return 0;
+      return NULL;
   }
   else
   {
@@ -320,10 +317,10 @@ int jsw_rbinsert(jsw_rbtree_t *tree, void *data)
       if (q == NULL)
       {
         /* Insert a new node at the first null link */
-        p->link[dir] = q = new_node(tree, data);
+        p->link[dir] = q = inserted = new_node(tree, data);
 
         if (q == NULL)
-          return 0;
+          return NULL;
       }
       else if (is_red(q->link[0]) && is_red(q->link[1]))
       {
@@ -368,9 +365,30 @@ int jsw_rbinsert(jsw_rbtree_t *tree, void *data)
 
   /* Make the root black for simplified logic */
   tree->root->red = 0;
+
+  if (inserted == NULL)
+    return NULL;
+
   ++tree->size;
 
-  return 1;
+  return inserted->data;
+}
+
+/**
+  <summary>
+  Insert a copy of the user-specified
+  data into a red black tree
+  <summary>
+  <param name="tree">The tree to insert into</param>
+  <param name="data">The data value to insert</param>
+  <returns>
+  1 if the value was inserted successfully,
+  0 if the insertion failed for any reason
+  </returns>
+*/
+int jsw_rbinsert(jsw_rbtree_t *tree, void *data)
+{
+  return jsw_rbinsert_data(tree, data) != NULL;
 }
 
 /**
@@ -467,7 +485,9 @@ int jsw_rberase(jsw_rbtree_t *tree, void *data)
       f->data = q->data;
       p->link[p->link[1] == q] =
           q->link[q->link[0] == NULL];
-      free(q);
+      /* Lock free predecessor queries may still be walking it */
+      pool_retire(&node_pool, q);
+      --tree->size;
     }
 
     /* Update the root (it may be different) */
@@ -477,10 +497,10 @@ int jsw_rberase(jsw_rbtree_t *tree, void *data)
     if (tree->root != NULL)
       tree->root->red = 0;
 
-    --tree->size;
+    return f != NULL;
   }
 
-  return 1;
+  return 0;
 }
 
 /**
@@ -508,7 +528,7 @@ size_t jsw_rbsize(jsw_rbtree_t *tree)
 */
 jsw_rbtrav_t *jsw_rbtnew(void)
 {
-  return (jsw_rbtrav_t *)malloc(sizeof(jsw_rbtrav_t));
+  return (jsw_rbtrav_t *)pool_alloc(&trav_pool);
 }
 
 /**
@@ -522,7 +542,7 @@ jsw_rbtrav_t *jsw_rbtnew(void)
 */
 void jsw_rbtdelete(jsw_rbtrav_t *trav)
 {
-  free(trav);
+  pool_free(&trav_pool, trav);
 }
 
 /**
@@ -619,6 +639,48 @@ void *jsw_rbtfirst(jsw_rbtrav_t *trav, jsw_rbtree_t *tree)
   return start(trav, tree, 0); /* Min value */
 }
 
+/**
+  <summary>
+  Initialize a traversal object to the smallest node
+  that is not less than the user-specified data
+  <summary>
+  <param name="trav">The traversal object to initialize</param>
+  <param name="tree">The tree that the object will be attached to</param>
+  <param name="data">The data value to seek to</param>
+  <returns>A pointer to that data value, or NULL if every value is less</returns>
+*/
+void *jsw_rbtseek(jsw_rbtrav_t *trav, jsw_rbtree_t *tree, void *data)
+{
+  jsw_rbnode_t *curr = tree->root;
+  size_t found_top = 0;
+
+  trav->tree = tree;
+  trav->it = NULL;
+  trav->top = 0;
+
+  /*
+    Every node on the way down is saved; the path of the
+    last candidate is the prefix saved before reaching it
+  */
+  while (curr != NULL)
+  {
+    int dir = tree->cmp(curr->data, data) < 0;
+
+    if (!dir)
+    {
+      trav->it = curr;
+      found_top = trav->top;
+    }
+
+    trav->path[trav->top++] = curr;
+    curr = curr->link[dir];
+  }
+
+  trav->top = found_top;
+
+  return trav->it == NULL ? NULL : trav->it->data;
+}
+
 /**
   <summary>
   Initialize a traversal object to the largest valued node
@@ -42,9 +42,10 @@ jsw_rbtree_t *jsw_rbnew ( cmp_f cmp, dup_f dup, rel_f rel);
 void          jsw_rbdelete ( jsw_rbtree_t *tree );
 void         *jsw_rbfind ( jsw_rbtree_t *tree, void *data );
 
-void         *jsw_rbfind_GLT(jsw_rbtree_t *tree, void *data, void* curr_high);
+void         *jsw_rbfind_GLT ( jsw_rbtree_t *tree, void *data, void **next );
 
 int           jsw_rbinsert ( jsw_rbtree_t *tree, void *data );
+void         *jsw_rbinsert_data ( jsw_rbtree_t *tree, void *data );
 int           jsw_rberase ( jsw_rbtree_t *tree, void *data );
 size_t        jsw_rbsize ( jsw_rbtree_t *tree );
 
@@ -52,6 +53,7 @@ size_t        jsw_rbsize ( jsw_rbtree_t *tree );
 jsw_rbtrav_t *jsw_rbtnew ( void );
 void          jsw_rbtdelete ( jsw_rbtrav_t *trav );
 void         *jsw_rbtfirst ( jsw_rbtrav_t *trav, jsw_rbtree_t *tree );
+void         *jsw_rbtseek ( jsw_rbtrav_t *trav, jsw_rbtree_t *tree, void *data );
 void         *jsw_rbtlast ( jsw_rbtrav_t *trav, jsw_rbtree_t *tree );
 void         *jsw_rbtnext ( jsw_rbtrav_t *trav );
 void         *jsw_rbtprev ( jsw_rbtrav_t *trav );
@@ -0,0 +1,246 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "poison.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define POISON_X86 1
+#endif
+
+//Kernels filling a range with one byte and checking a range still holds
+//it. The vector kernels are compiled for their instruction set with a
+//target attribute and chosen at run time by what the CPU supports, so the
+//rest of the program needs no special flags
+
+//A set of kernels
+typedef struct poison_ops
+{
+	const char *name;
+	void (*fill)(void *ptr, size_t length, unsigned char byte);
+	int (*intact)(const void *ptr, size_t length, unsigned char byte);
+} poison_ops;
+
+static const poison_ops *ops;
+static pthread_once_t ops_once = PTHREAD_ONCE_INIT;
+
+//Fill a range a word at a time
+static void scalar_fill(void *ptr, size_t length, unsigned char byte)
+{
+	unsigned char *bytes = ptr;
+	uint64_t pattern;
+	size_t i = 0;
+
+	memset(&pattern, byte, sizeof(pattern));
+
+	for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t))
+	{
+		memcpy(bytes + i, &pattern, sizeof(pattern));
+	}
+	for (; i < length; i++)
+	{
+		bytes[i] = byte;
+	}
+}
+
+//Check a range a word at a time
+static int scalar_intact(const void *ptr, size_t length, unsigned char byte)
+{
+	const unsigned char *bytes = ptr;
+	uint64_t pattern, word, diff = 0;
+	size_t i = 0;
+
+	memset(&pattern, byte, sizeof(pattern));
+
+	for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t))
+	{
+		memcpy(&word, bytes + i, sizeof(word));
+		diff |= word ^ pattern;
+	}
+	for (; i < length; i++)
+	{
+		diff |= bytes[i] ^ byte;
+	}
+
+	return diff == 0;
+}
+
+static const poison_ops scalar_ops = { "scalar", scalar_fill, scalar_intact };
+
+#ifdef POISON_X86
+
+//Fill a range 16 bytes at a time
+__attribute__((target("sse2")))
+static void sse2_fill(void *ptr, size_t length, unsigned char byte)
+{
+	unsigned char *bytes = ptr;
+	__m128i pattern = _mm_set1_epi8((char)byte);
+	size_t i = 0;
+
+	for (; i + 64 <= length; i += 64)
+	{
+		_mm_storeu_si128((__m128i *)(bytes + i), pattern);
+		_mm_storeu_si128((__m128i *)(bytes + i + 16), pattern);
+		_mm_storeu_si128((__m128i *)(bytes + i + 32), pattern);
+		_mm_storeu_si128((__m128i *)(bytes + i + 48), pattern);
+	}
+	for (; i + 16 <= length; i += 16)
+	{
+		_mm_storeu_si128((__m128i *)(bytes + i), pattern);
+	}
+
+	scalar_fill(bytes + i, length - i, byte);
+}
+
+//Check a range 16 bytes at a time, gathering differences from the
+//pattern and testing them once at the end
+__attribute__((target("sse2")))
+static int sse2_intact(const void *ptr, size_t length, unsigned char byte)
+{
+	const unsigned char *bytes = ptr;
+	__m128i pattern = _mm_set1_epi8((char)byte);
+	__m128i diff = _mm_setzero_si128();
+	size_t i = 0;
+
+	for (; i + 64 <= length; i += 64)
+	{
+		diff = _mm_or_si128(diff, _mm_xor_si128(_mm_loadu_si128((const __m128i *)(bytes + i)), pattern));
+		diff = _mm_or_si128(diff, _mm_xor_si128(_mm_loadu_si128((const __m128i *)(bytes + i + 16)), pattern));
+		diff = _mm_or_si128(diff, _mm_xor_si128(_mm_loadu_si128((const __m128i *)(bytes + i + 32)), pattern));
+		diff = _mm_or_si128(diff, _mm_xor_si128(_mm_loadu_si128((const __m128i *)(bytes + i + 48)), pattern));
+	}
+	for (; i + 16 <= length; i += 16)
+	{
+		diff = _mm_or_si128(diff, _mm_xor_si128(_mm_loadu_si128((const __m128i *)(bytes + i)), pattern));
+	}
+
+	if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) != 0xFFFF)
+	{
+		return 0;
+	}
+
+	return scalar_intact(bytes + i, length - i, byte);
+}
+
+//Fill a range 32 bytes at a time
+__attribute__((target("avx2")))
+static void avx2_fill(void *ptr, size_t length, unsigned char byte)
+{
+	unsigned char *bytes = ptr;
+	__m256i pattern = _mm256_set1_epi8((char)byte);
+	size_t i = 0;
+
+	for (; i + 128 <= length; i += 128)
+	{
+		_mm256_storeu_si256((__m256i *)(bytes + i), pattern);
+		_mm256_storeu_si256((__m256i *)(bytes + i + 32), pattern);
+		_mm256_storeu_si256((__m256i *)(bytes + i + 64), pattern);
+		_mm256_storeu_si256((__m256i *)(bytes + i + 96), pattern);
+	}
+	for (; i + 32 <= length; i += 32)
+	{
+		_mm256_storeu_si256((__m256i *)(bytes + i), pattern);
+	}
+
+	scalar_fill(bytes + i, length - i, byte);
+}
+
+//Check a range 32 bytes at a time
+__attribute__((target("avx2")))
+static int avx2_intact(const void *ptr, size_t length, unsigned char byte)
+{
+	const unsigned char *bytes = ptr;
+	__m256i pattern = _mm256_set1_epi8((char)byte);
+	__m256i diff = _mm256_setzero_si256();
+	size_t i = 0;
+
+	for (; i + 128 <= length; i += 128)
+	{
+		diff = _mm256_or_si256(diff, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(bytes + i)), pattern));
+		diff = _mm256_or_si256(diff, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(bytes + i + 32)), pattern));
+		diff = _mm256_or_si256(diff, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(bytes + i + 64)), pattern));
+		diff = _mm256_or_si256(diff, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(bytes + i + 96)), pattern));
+	}
+	for (; i + 32 <= length; i += 32)
+	{
+		diff = _mm256_or_si256(diff, _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(bytes + i)), pattern));
+	}
+
+	if (!_mm256_testz_si256(diff, diff))
+	{
+		return 0;
+	}
+
+	return scalar_intact(bytes + i, length - i, byte);
+}
+
+static const poison_ops sse2_ops = { "sse2", sse2_fill, sse2_intact };
+static const poison_ops avx2_ops = { "avx2", avx2_fill, avx2_intact };
+
+#endif
+
+//Choose the kernels: the one named by MALLOC537_POISON_KERNEL if the CPU
+//supports it, otherwise the widest one it supports
+static void ops_select()
+{
+	const char *name = getenv(POISON_KERNEL_ENV);
+	const poison_ops *best = &scalar_ops;
+
+	if (name != NULL && name[0] == '\0')
+	{
+		name = NULL;
+	}
+
+#ifdef POISON_X86
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+	{
+		best = &avx2_ops;
+	}
+	else if (__builtin_cpu_supports("sse2"))
+	{
+		best = &sse2_ops;
+	}
+
+	if (name != NULL && strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2"))
+	{
+		best = &sse2_ops;
+		name = NULL;
+	}
+#endif
+
+	if (name != NULL && strcmp(name, "scalar") == 0)
+	{
+		best = &scalar_ops;
+	}
+	else if (name != NULL && strcmp(name, best->name) != 0)
+	{
+		fprintf(stderr, "Warning: Poison kernel %s not supported, using %s\n", name, best->name);
+	}
+
+	ops = best;
+}
+
+//Fill the length bytes at ptr with byte
+void poison_fill(void *ptr, size_t length, unsigned char byte)
+{
+	pthread_once(&ops_once, ops_select);
+	ops->fill(ptr, length, byte);
+}
+
+//Return nonzero if every one of the length bytes at ptr holds byte
+int poison_intact(const void *ptr, size_t length, unsigned char byte)
+{
+	pthread_once(&ops_once, ops_select);
+	return ops->intact(ptr, length, byte);
+}
+
+//Return the name of the kernels in use
+const char *poison_kernel()
+{
+	pthread_once(&ops_once, ops_select);
+	return ops->name;
+}
@@ -0,0 +1,24 @@
+#ifndef POISON_H
+#define POISON_H
+
+#include <stddef.h>
+
+//Environment variable that turns on filling fresh and freed blocks when
+//set to anything but "0"
+#define POISON_FILL_ENV "MALLOC537_FILL"
+
+//Environment variable forcing a kernel: "avx2", "sse2" or "scalar". The
+//best one the CPU supports is used if it is unset or not supported
+#define POISON_KERNEL_ENV "MALLOC537_POISON_KERNEL"
+
+//Byte fresh blocks are filled with, so reads of memory never written stand out
+#define POISON_FRESH 0xCD
+
+//Poison Functions
+void poison_fill(void *ptr, size_t length, unsigned char byte);
+
+int poison_intact(const void *ptr, size_t length, unsigned char byte);
+
+const char *poison_kernel();
+
+#endif
@@ -0,0 +1,183 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include "epoch.h"
+#include "pool.h"
+
+//Totals over every pool, so the tracker's own footprint can be reported
+static size_t total_mapped;
+static size_t total_used;
+
+//Take and release the pool's spin lock
+static void pool_lock(pool *pool)
+{
+	while (__atomic_test_and_set(&pool->lock, __ATOMIC_ACQUIRE))
+	{
+		while (__atomic_load_n(&pool->lock, __ATOMIC_RELAXED))
+		{
+#if defined(__x86_64__) || defined(__i386__)
+			__builtin_ia32_pause();
+#endif
+		}
+	}
+}
+
+static void pool_unlock(pool *pool)
+{
+	__atomic_clear(&pool->lock, __ATOMIC_RELEASE);
+}
+
+//Initialize an empty pool that hands out objects of obj_size bytes
+void pool_init(pool *pool, size_t obj_size)
+{
+	pool->obj_size = (obj_size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+	pool->free_list = NULL;
+	pool->next = NULL;
+	pool->end = NULL;
+	pool->chunks = NULL;
+	pool->mapped_bytes = 0;
+	pool->used_bytes = 0;
+	pool->lock = 0;
+}
+
+//Map a new chunk for the pool and point the bump pointer at it
+//Return 0 on success, -1 if the mapping failed
+static int pool_grow(pool *pool)
+{
+	size_t bytes = POOL_CHUNK_BYTES;
+	pool_chunk *chunk;
+
+	//A chunk always holds at least one object after its header
+	if (bytes < POOL_ALIGN + pool->obj_size)
+	{
+		bytes = (POOL_ALIGN + pool->obj_size + 4095) & ~(size_t)4095;
+	}
+
+	chunk = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (chunk == MAP_FAILED)
+	{
+		return -1;
+	}
+
+	chunk->next = pool->chunks;
+	chunk->bytes = bytes;
+	pool->chunks = chunk;
+
+	pool->next = (char *)chunk + POOL_ALIGN;
+	pool->end = (char *)chunk + bytes;
+
+	pool->mapped_bytes += bytes;
+	__atomic_fetch_add(&total_mapped, bytes, __ATOMIC_RELAXED);
+
+	return 0;
+}
+
+//Return an uninitialized object from the pool, or NULL if out of memory
+void *pool_alloc(pool *pool)
+{
+	void *obj;
+
+	pool_lock(pool);
+	obj = pool->free_list;
+
+	//Reuse a freed object first
+	if (obj != NULL)
+	{
+		pool->free_list = *(void **)obj;
+	}
+	else
+	{
+		if ((size_t)(pool->end - pool->next) < pool->obj_size && pool_grow(pool) != 0)
+		{
+			pool_unlock(pool);
+			return NULL;
+		}
+
+		obj = pool->next;
+		pool->next += pool->obj_size;
+	}
+
+	pool->used_bytes += pool->obj_size;
+	pool_unlock(pool);
+
+	__atomic_fetch_add(&total_used, pool->obj_size, __ATOMIC_RELAXED);
+
+	return obj;
+}
+
+//Return a zero filled object from the pool, or NULL if out of memory
+void *pool_calloc(pool *pool)
+{
+	void *obj = pool_alloc(pool);
+
+	if (obj != NULL)
+	{
+		memset(obj, 0, pool->obj_size);
+	}
+
+	return obj;
+}
+
+//Give an object back to the pool it was allocated from
+void pool_free(pool *pool, void *obj)
+{
+	if (obj == NULL)
+	{
+		return;
+	}
+
+	pool_lock(pool);
+	*(void **)obj = pool->free_list;
+	pool->free_list = obj;
+
+	pool->used_bytes -= pool->obj_size;
+	pool_unlock(pool);
+
+	__atomic_fetch_sub(&total_used, pool->obj_size, __ATOMIC_RELAXED);
+}
+
+//Reclaim an object retired by pool_retire
+static void pool_reclaim(void *obj, void *arg)
+{
+	pool_free(arg, obj);
+}
+
+//Give an object back to the pool once no epoch reader can still hold it
+void pool_retire(pool *pool, void *obj)
+{
+	if (obj != NULL)
+	{
+		epoch_retire(obj, pool_reclaim, pool);
+	}
+}
+
+//Unmap every chunk of the pool, releasing all of its objects at once
+void pool_destroy(pool *pool)
+{
+	pool_chunk *chunk = pool->chunks;
+
+	while (chunk != NULL)
+	{
+		pool_chunk *next = chunk->next;
+		munmap(chunk, chunk->bytes);
+		chunk = next;
+	}
+
+	__atomic_fetch_sub(&total_mapped, pool->mapped_bytes, __ATOMIC_RELAXED);
+	__atomic_fetch_sub(&total_used, pool->used_bytes, __ATOMIC_RELAXED);
+
+	pool_init(pool, pool->obj_size);
+}
+
+//Return the number of bytes mapped by all pools
+size_t pool_total_mapped()
+{
+	return __atomic_load_n(&total_mapped, __ATOMIC_RELAXED);
+}
+
+//Return the number of bytes handed out by all pools and not yet freed
+size_t pool_total_used()
+{
+	return __atomic_load_n(&total_used, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,56 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+//Bytes mapped per pool chunk, unless one object needs more
+#define POOL_CHUNK_BYTES (1 << 20)
+
+//Objects are handed out from chunks that begin on a cache line
+#define POOL_ALIGN 64
+
+//Header at the start of every mmap'd chunk
+typedef struct pool_chunk
+{
+	struct pool_chunk *next;
+	size_t bytes;
+
+} pool_chunk;
+
+//Fixed-size object pool. Objects are bump allocated from mmap'd chunks
+//and recycled through a free list threaded through the freed objects.
+//A spin lock makes pools shared between threads safe to use
+typedef struct pool
+{
+	size_t obj_size;
+	void *free_list;
+	char *next;
+	char *end;
+	pool_chunk *chunks;
+	size_t mapped_bytes;
+	size_t used_bytes;
+	char lock;
+
+} pool;
+
+//Static initializer for a pool of objects of the given size
+#define POOL_INITIALIZER(size) { (((size) + sizeof(void *) - 1) & ~(sizeof(void *) - 1)), NULL, NULL, NULL, NULL, 0, 0, 0 }
+
+//Pool Functions
+void pool_init(pool *pool, size_t obj_size);
+
+void *pool_alloc(pool *pool);
+
+void *pool_calloc(pool *pool);
+
+void pool_free(pool *pool, void *obj);
+
+void pool_retire(pool *pool, void *obj);
+
+void pool_destroy(pool *pool);
+
+size_t pool_total_mapped();
+
+size_t pool_total_used();
+
+#endif
@@ -0,0 +1,242 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include "epoch.h"
+#include "ptr_hash.h"
+
+//Readers may run while the table changes (see ptr_hash_get), so every
+//slot is read and written atomically
+#define LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+#define STORE(field, value) __atomic_store_n(&(field), (value), __ATOMIC_RELAXED)
+
+//Home slot of a key in a table with the given mask. Block addresses are 16
+//byte aligned, so the low bits are dropped before Fibonacci hashing spreads
+//the rest over the table
+static size_t home_of(size_t mask, void *key)
+{
+	uintptr_t bits = (uintptr_t)key >> 4;
+
+	return (size_t)((bits * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
+static size_t slot_of(ptr_hash *hash, void *key)
+{
+	return home_of(hash->mask, key);
+}
+
+//Bytes mapped for slots over every table, retired ones included
+static size_t total_mapped;
+
+//Unmap a slot array retired by resize
+static void slots_unmap(void *slots, void *bytes)
+{
+	munmap(slots, (size_t)bytes);
+	__atomic_fetch_sub(&total_mapped, (size_t)bytes, __ATOMIC_RELAXED);
+}
+
+//Map a zero filled slot array with the given number of slots
+static ptr_hash_slot *slots_map(size_t count)
+{
+	void *slots = mmap(NULL, count * sizeof(ptr_hash_slot), PROT_READ | PROT_WRITE,
+					   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (slots == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	__atomic_fetch_add(&total_mapped, count * sizeof(ptr_hash_slot), __ATOMIC_RELAXED);
+	return slots;
+}
+
+//Initialize an empty table, the slots are mapped on the first put
+void ptr_hash_init(ptr_hash *hash)
+{
+	hash->slots = NULL;
+	hash->mask = 0;
+	hash->count = 0;
+	hash->mapped_bytes = 0;
+}
+
+//Unmap the table's slots and leave it empty
+void ptr_hash_destroy(ptr_hash *hash)
+{
+	if (hash->slots != NULL)
+	{
+		slots_unmap(hash->slots, (void *)hash->mapped_bytes);
+	}
+
+	ptr_hash_init(hash);
+}
+
+//Move every entry into a table with the given number of slots
+//The new slots are published before the larger mask, so a reader that sees
+//the new mask also sees the new slots. The old slots stay mapped until
+//no epoch reader can still be probing them
+//Return 0 on success, -1 if the new table could not be mapped
+static int resize(ptr_hash *hash, size_t count)
+{
+	ptr_hash_slot *old = hash->slots;
+	size_t old_count = (old == NULL) ? 0 : hash->mask + 1;
+	size_t old_bytes = hash->mapped_bytes;
+	ptr_hash_slot *slots = slots_map(count);
+
+	if (slots == NULL)
+	{
+		return -1;
+	}
+
+	for (size_t i = 0; i < old_count; i++)
+	{
+		if (old[i].key != NULL)
+		{
+			size_t j = home_of(count - 1, old[i].key);
+
+			while (slots[j].key != NULL)
+			{
+				j = (j + 1) & (count - 1);
+			}
+			slots[j] = old[i];
+		}
+	}
+
+	__atomic_store_n(&hash->slots, slots, __ATOMIC_RELEASE);
+	__atomic_store_n(&hash->mask, count - 1, __ATOMIC_RELEASE);
+	hash->mapped_bytes = count * sizeof(ptr_hash_slot);
+
+	if (old != NULL)
+	{
+		epoch_retire(old, slots_unmap, (void *)old_bytes);
+	}
+
+	return 0;
+}
+
+//Grow the table once, if needed, so that extra more keys can be put
+//without it resizing again
+//Return 0 on success, -1 if the table could not grow
+int ptr_hash_reserve(ptr_hash *hash, size_t extra)
+{
+	size_t want = hash->count + extra;
+	size_t count = (hash->slots == NULL) ? PTR_HASH_MIN_SLOTS : hash->mask + 1;
+
+	//Keep the load factor under 3/4 so probe sequences stay short
+	while (want * 4 > count * 3)
+	{
+		count *= 2;
+	}
+
+	if (hash->slots != NULL && count == hash->mask + 1)
+	{
+		return 0;
+	}
+
+	return resize(hash, count);
+}
+
+//Map key to value, replacing any value it had
+//Return 0 on success, -1 if the table could not grow
+int ptr_hash_put(ptr_hash *hash, void *key, void *value)
+{
+	size_t i;
+
+	if (ptr_hash_reserve(hash, 1) != 0)
+	{
+		return -1;
+	}
+
+	i = slot_of(hash, key);
+	while (hash->slots[i].key != NULL)
+	{
+		if (hash->slots[i].key == key)
+		{
+			STORE(hash->slots[i].value, value);
+			return 0;
+		}
+		i = (i + 1) & hash->mask;
+	}
+
+	STORE(hash->slots[i].value, value);
+	STORE(hash->slots[i].key, key);
+	hash->count++;
+
+	return 0;
+}
+
+//Return the value mapped to key, or NULL if the key is not in the table
+//May run inside an epoch read section while another thread changes the
+//table: it never faults, but an entry being moved can be missed, so such
+//readers must check that the table did not change during the call
+void *ptr_hash_get(ptr_hash *hash, void *key)
+{
+	size_t mask = __atomic_load_n(&hash->mask, __ATOMIC_ACQUIRE);
+	ptr_hash_slot *slots = __atomic_load_n(&hash->slots, __ATOMIC_ACQUIRE);
+	void *found;
+	size_t i;
+
+	if (slots == NULL)
+	{
+		return NULL;
+	}
+
+	for (i = home_of(mask, key); (found = LOAD(slots[i].key)) != NULL; i = (i + 1) & mask)
+	{
+		if (found == key)
+		{
+			return LOAD(slots[i].value);
+		}
+	}
+
+	return NULL;
+}
+
+//Remove key from the table, returning its value or NULL if it was not there
+void *ptr_hash_remove(ptr_hash *hash, void *key)
+{
+	size_t i, j;
+	void *value;
+
+	if (hash->slots == NULL)
+	{
+		return NULL;
+	}
+
+	for (i = slot_of(hash, key); hash->slots[i].key != key; i = (i + 1) & hash->mask)
+	{
+		if (hash->slots[i].key == NULL)
+		{
+			return NULL;
+		}
+	}
+
+	value = hash->slots[i].value;
+
+	//Shift later members of the probe run back into the hole, so lookups
+	//never need to skip over deleted slots
+	for (j = (i + 1) & hash->mask; hash->slots[j].key != NULL; j = (j + 1) & hash->mask)
+	{
+		size_t home = slot_of(hash, hash->slots[j].key);
+
+		//The entry at j may move to i only if its home is not in (i, j]
+		if (((j - home) & hash->mask) >= ((j - i) & hash->mask))
+		{
+			STORE(hash->slots[i].value, hash->slots[j].value);
+			STORE(hash->slots[i].key, hash->slots[j].key);
+			i = j;
+		}
+	}
+
+	STORE(hash->slots[i].key, NULL);
+	STORE(hash->slots[i].value, NULL);
+	hash->count--;
+
+	return value;
+}
+
+//Return the bytes mapped for slots by every table
+size_t ptr_hash_total_mapped()
+{
+	return __atomic_load_n(&total_mapped, __ATOMIC_RELAXED);
+}
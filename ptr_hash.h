@@ -0,0 +1,43 @@
+#ifndef PTR_HASH_H
+#define PTR_HASH_H
+
+#include <stddef.h>
+
+//Slots in a new table, a power of two
+#define PTR_HASH_MIN_SLOTS 1024
+
+//One slot of the table, a NULL key marks an empty slot
+typedef struct ptr_hash_slot
+{
+	void *key;
+	void *value;
+
+} ptr_hash_slot;
+
+//Open addressing hash table from pointers to pointers, using linear probing
+//and backward shift deletion so that no tombstones are left behind
+typedef struct ptr_hash
+{
+	ptr_hash_slot *slots;
+	size_t mask;
+	size_t count;
+	size_t mapped_bytes;
+
+} ptr_hash;
+
+//Hash Table Functions
+void ptr_hash_init(ptr_hash *hash);
+
+void ptr_hash_destroy(ptr_hash *hash);
+
+int ptr_hash_reserve(ptr_hash *hash, size_t extra);
+
+int ptr_hash_put(ptr_hash *hash, void *key, void *value);
+
+void *ptr_hash_get(ptr_hash *hash, void *key);
+
+void *ptr_hash_remove(ptr_hash *hash, void *key);
+
+size_t ptr_hash_total_mapped();
+
+#endif
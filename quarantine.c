@@ -0,0 +1,152 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "poison.h"
+#include "quarantine.h"
+
+//Quarantine of freed blocks. A freed block is poisoned and held back in a
+//FIFO ring; once the blocks held exceed the byte budget the oldest are
+//evicted, and the evict function checks the poison is intact before the
+//block is really freed, catching writes through dangling pointers
+
+//A block held in the quarantine
+typedef struct quarantined
+{
+	void *ptr;
+	size_t length;
+} quarantined;
+
+//Ring of held blocks, oldest at head
+static quarantined *ring;
+static size_t ring_capacity;
+static size_t ring_head;
+static size_t ring_count;
+static size_t ring_mapped;
+
+static size_t held_bytes;
+static size_t budget;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+//Evict the oldest blocks until no more than limit bytes are held
+//Must be called with the lock held
+static void evict_to(size_t limit, quarantine_evict_f evict)
+{
+	while (held_bytes > limit)
+	{
+		quarantined oldest = ring[ring_head];
+
+		ring_head = (ring_head + 1) % ring_capacity;
+		ring_count--;
+		__atomic_store_n(&held_bytes, held_bytes - oldest.length, __ATOMIC_RELAXED);
+
+		evict(oldest.ptr, oldest.length);
+	}
+}
+
+//Make room for one more block in the ring, mapping a ring twice the size
+//so the quarantine stays out of the application's heap
+//Return 0 on success, -1 if out of memory
+static int ring_grow()
+{
+	size_t capacity = (ring_capacity == 0) ? QUARANTINE_MIN_ENTRIES : ring_capacity * 2;
+	quarantined *grown = mmap(NULL, capacity * sizeof(quarantined), PROT_READ | PROT_WRITE,
+							  MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (grown == MAP_FAILED)
+	{
+		return -1;
+	}
+
+	//Unwrap the ring so the oldest block comes first
+	for (size_t i = 0; i < ring_count; i++)
+	{
+		grown[i] = ring[(ring_head + i) % ring_capacity];
+	}
+
+	if (ring != NULL)
+	{
+		munmap(ring, ring_capacity * sizeof(quarantined));
+	}
+	__atomic_store_n(&ring_mapped, capacity * sizeof(quarantined), __ATOMIC_RELAXED);
+	ring = grown;
+	ring_capacity = capacity;
+	ring_head = 0;
+
+	return 0;
+}
+
+//Hold back at most bytes of freed blocks, evicting the oldest through
+//evict if more than that are held now. 0 turns the quarantine off
+void quarantine_set_budget(size_t bytes, quarantine_evict_f evict)
+{
+	pthread_mutex_lock(&lock);
+	__atomic_store_n(&budget, bytes, __ATOMIC_RELAXED);
+	evict_to(bytes, evict);
+	pthread_mutex_unlock(&lock);
+}
+
+//Return the byte budget, 0 if the quarantine is off
+size_t quarantine_budget()
+{
+	return __atomic_load_n(&budget, __ATOMIC_RELAXED);
+}
+
+//Return the bytes of freed blocks currently held
+size_t quarantine_held()
+{
+	return __atomic_load_n(&held_bytes, __ATOMIC_RELAXED);
+}
+
+//Return the bytes mapped for the ring
+size_t quarantine_mapped_bytes()
+{
+	return __atomic_load_n(&ring_mapped, __ATOMIC_RELAXED);
+}
+
+//Poison the freed block at ptr and hold it back, evicting the oldest
+//blocks through evict to stay within the budget
+//Return 0 if the block was taken, -1 if the quarantine is off, the block
+//is larger than the budget or the ring could not grow, in which case the
+//caller frees it itself
+int quarantine_put(void *ptr, size_t length, quarantine_evict_f evict)
+{
+	int ret = 0;
+
+	size_t limit = quarantine_budget();
+
+	if (limit == 0 || length > limit)
+	{
+		return -1;
+	}
+
+	poison_fill(ptr, length, QUARANTINE_POISON);
+
+	pthread_mutex_lock(&lock);
+	if (ring_count == ring_capacity && ring_grow() != 0)
+	{
+		ret = -1;
+	}
+	else
+	{
+		ring[(ring_head + ring_count) % ring_capacity].ptr = ptr;
+		ring[(ring_head + ring_count) % ring_capacity].length = length;
+		ring_count++;
+		__atomic_store_n(&held_bytes, held_bytes + length, __ATOMIC_RELAXED);
+
+		//The budget may have shrunk since it was checked
+		evict_to(budget, evict);
+	}
+	pthread_mutex_unlock(&lock);
+
+	return ret;
+}
+
+//Return nonzero if every byte of the length byte block at ptr still holds
+//the poison
+int quarantine_intact(void *ptr, size_t length)
+{
+	return poison_intact(ptr, length, QUARANTINE_POISON);
+}
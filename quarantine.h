@@ -0,0 +1,32 @@
+#ifndef QUARANTINE_H
+#define QUARANTINE_H
+
+#include <stddef.h>
+
+//Environment variable holding the quarantine's byte budget, 0 (the
+//default) turns it off
+#define QUARANTINE_ENV "MALLOC537_QUARANTINE"
+
+//Byte every quarantined block is filled with
+#define QUARANTINE_POISON 0xFD
+
+//Entries the ring starts with before it has to grow, a page's worth
+#define QUARANTINE_MIN_ENTRIES 256
+
+//Called with a block leaving the quarantine, to verify and release it
+typedef void (*quarantine_evict_f)(void *ptr, size_t length);
+
+//Quarantine Functions
+void quarantine_set_budget(size_t bytes, quarantine_evict_f evict);
+
+size_t quarantine_budget();
+
+size_t quarantine_held();
+
+size_t quarantine_mapped_bytes();
+
+int quarantine_put(void *ptr, size_t length, quarantine_evict_f evict);
+
+int quarantine_intact(void *ptr, size_t length);
+
+#endif
@@ -2,9 +2,47 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <math.h>
+#include <stdint.h>
 #include "rb_tree.h"
+#include "jsw_rbtree.h"
+#include "bptree.h"
+#include "pool.h"
+#include "ptr_hash.h"
+#include "epoch.h"
 #include "range_tree.h"
 
+//A tree is a backend's own tree paired with the backend's operations, plus
+//a hash index from start address to node that answers exact lookups
+//without searching the backend
+struct tree
+{
+	const tree_ops *ops;
+	void *impl;
+	ptr_hash index;
+	unsigned long version;
+};
+
+//Stamp given to a tree each time it changes. It is shared by every tree,
+//so a stamp is never reused even when a tree's memory is
+static unsigned long tree_versions;
+
+//The last predecessor query made by this thread: low is the answer for
+//every address above low and at most high (NULL meaning no bound), for as
+//long as the tree keeps the version it had when the query ran
+typedef struct glt_finger
+{
+	const tree *owner;
+	unsigned long version;
+	node *low;
+	node *high;
+} glt_finger;
+
+static __thread glt_finger finger;
+
+//Node copies made by node_duplicate for non-intrusive trees
+static pool node_pool = POOL_INITIALIZER(sizeof(node));
+static pool tree_pool = POOL_INITIALIZER(sizeof(tree));
+
 //Compare two node according to their addresses
 //Return 1 if the first argument has a larger address than second argument
 //Return -1 if the second argurment has a larger address than the first argument
@@ -31,60 +69,355 @@ void *node_duplicate(void *p)
 {
 	void *dup_p;
 
-	dup_p = calloc(1, sizeof(struct node));
+	dup_p = pool_alloc(&node_pool);
 	memmove(dup_p, p, sizeof(struct node));
 
 	return dup_p;
 }
 
-//Free the memory of the passed in node
+//Free the memory of the passed in node once no epoch reader can still
+//hold it
 void node_free(void *p)
 {
-	free(p);
+	pool_retire(&node_pool, p);
+}
+
+//Red-black tree backend (rb_tree.c). The tree is intrusive: each node
+//struct is stored inside its red-black node, so an insert costs one
+//pool allocation
+static void *rb_index_create()
+{
+	return rb_new_intrusive(node_cmp, sizeof(node));
+}
+
+static void rb_index_destroy(void *impl)
+{
+	rb_delete(impl);
+}
+
+static node *rb_index_insert(void *impl, node *data)
+{
+	return rb_insert_data(impl, data);
+}
+
+static int rb_index_erase(void *impl, void *addr)
+{
+	node node_find;
+
+	node_find.addr = addr;
+	return rb_erase(impl, &node_find);
+}
+
+static node *rb_index_find(void *impl, void *addr)
+{
+	node node_find;
+
+	node_find.addr = addr;
+	return rb_find(impl, &node_find);
+}
+
+static node *rb_index_find_GLT(void *impl, void *addr, node **next)
+{
+	node node_find;
+
+	//Returned node must have an address that is less than this address
+	node_find.addr = addr;
+	return rb_find_GLT(impl, &node_find, (void **)next);
+}
+
+static void rb_index_walk(void *impl, void *from, tree_visit_f visit, void *arg)
+{
+	node node_find, *curr;
+	rb_trav_t *rbtrav = rb_tnew();
+
+	node_find.addr = from;
+	for (curr = rb_tseek(rbtrav, impl, &node_find); curr != NULL; curr = rb_tnext(rbtrav))
+	{
+		if (visit(curr, arg))
+		{
+			break;
+		}
+	}
+
+	rb_tdelete(rbtrav);
+}
+
+static size_t rb_index_size(void *impl)
+{
+	return rb_size(impl);
+}
+
+//Red-black tree backend (jsw_rbtree.c). Nodes are copied with
+//node_duplicate, so each insert costs a tree node and a node copy
+static void *jsw_index_create()
+{
+	return jsw_rbnew(node_cmp, node_duplicate, node_free);
+}
+
+static void jsw_index_destroy(void *impl)
+{
+	jsw_rbdelete(impl);
+}
+
+static node *jsw_index_insert(void *impl, node *data)
+{
+	return jsw_rbinsert_data(impl, data);
+}
+
+static int jsw_index_erase(void *impl, void *addr)
+{
+	node node_find;
+
+	node_find.addr = addr;
+	return jsw_rberase(impl, &node_find);
+}
+
+static node *jsw_index_find(void *impl, void *addr)
+{
+	node node_find;
+
+	node_find.addr = addr;
+	return jsw_rbfind(impl, &node_find);
+}
+
+static node *jsw_index_find_GLT(void *impl, void *addr, node **next)
+{
+	node node_find;
+
+	node_find.addr = addr;
+	return jsw_rbfind_GLT(impl, &node_find, (void **)next);
+}
+
+static void jsw_index_walk(void *impl, void *from, tree_visit_f visit, void *arg)
+{
+	node node_find, *curr;
+	jsw_rbtrav_t *jswtrav = jsw_rbtnew();
+
+	node_find.addr = from;
+	for (curr = jsw_rbtseek(jswtrav, impl, &node_find); curr != NULL; curr = jsw_rbtnext(jswtrav))
+	{
+		if (visit(curr, arg))
+		{
+			break;
+		}
+	}
+
+	jsw_rbtdelete(jswtrav);
+}
+
+static size_t jsw_index_size(void *impl)
+{
+	return jsw_rbsize(impl);
+}
+
+//B+ tree backend (bptree.c), keyed directly by address
+static void *bp_index_create()
+{
+	return bp_new(sizeof(node));
+}
+
+static void bp_index_destroy(void *impl)
+{
+	bp_delete(impl);
+}
+
+static node *bp_index_insert(void *impl, node *data)
+{
+	return bp_insert_data(impl, (uintptr_t)data->addr, data);
+}
+
+static int bp_index_erase(void *impl, void *addr)
+{
+	return bp_erase(impl, (uintptr_t)addr);
+}
+
+static node *bp_index_find(void *impl, void *addr)
+{
+	return bp_find(impl, (uintptr_t)addr);
+}
+
+static node *bp_index_find_GLT(void *impl, void *addr, node **next)
+{
+	return bp_find_GLT(impl, (uintptr_t)addr, (void **)next);
+}
+
+static void bp_index_walk(void *impl, void *from, tree_visit_f visit, void *arg)
+{
+	node *curr;
+	bp_trav_t *bptrav = bp_tnew();
+
+	for (curr = bp_tseek(bptrav, impl, (uintptr_t)from); curr != NULL; curr = bp_tnext(bptrav))
+	{
+		if (visit(curr, arg))
+		{
+			break;
+		}
+	}
+
+	bp_tdelete(bptrav);
+}
+
+static size_t bp_index_size(void *impl)
+{
+	return bp_size(impl);
+}
+
+//Every built in backend, selectable by name
+static const tree_ops backends[] = {
+	{"rb", rb_index_create, rb_index_destroy, rb_index_insert, rb_index_erase,
+	 rb_index_find, rb_index_find_GLT, rb_index_walk, rb_index_size},
+	{"jsw", jsw_index_create, jsw_index_destroy, jsw_index_insert, jsw_index_erase,
+	 jsw_index_find, jsw_index_find_GLT, jsw_index_walk, jsw_index_size},
+	{"bptree", bp_index_create, bp_index_destroy, bp_index_insert, bp_index_erase,
+	 bp_index_find, bp_index_find_GLT, bp_index_walk, bp_index_size},
+};
+
+//Return the built in backend with the given name, or NULL if there is none
+const tree_ops *tree_backend(const char *name)
+{
+	for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++)
+	{
+		if (strcmp(backends[i].name, name) == 0)
+		{
+			return &backends[i];
+		}
+	}
+
+	return NULL;
 }
 
 //Create a new tree structure and return the new tree
+//The backend is named by the MALLOC537_INDEX environment variable,
+//or is the red-black tree if it is unset or unknown
 tree *tree_create()
 {
-	rb_tree_t *rbtree;
-	rbtree = rb_new(node_cmp, node_duplicate, node_free);
+	const char *name = getenv(TREE_BACKEND_ENV);
+
+	if (name != NULL && tree_backend(name) == NULL)
+	{
+		fprintf(stderr, "Warning: Unknown index backend %s, using %s\n", name, TREE_DEFAULT_BACKEND);
+		name = NULL;
+	}
+
+	return tree_create_backend(name == NULL ? TREE_DEFAULT_BACKEND : name);
+}
+
+//Create a new tree using the built in backend with the given name
+//Return NULL if there is no such backend
+tree *tree_create_backend(const char *name)
+{
+	const tree_ops *ops = tree_backend(name);
 
-	return rbtree;
+	if (ops == NULL)
+	{
+		return NULL;
+	}
+
+	return tree_create_ops(ops);
+}
+
+//Create a new tree using the given backend operations
+tree *tree_create_ops(const tree_ops *ops)
+{
+	tree *rtn_tree = pool_alloc(&tree_pool);
+
+	rtn_tree->ops = ops;
+	rtn_tree->impl = ops->create();
+	ptr_hash_init(&rtn_tree->index);
+	rtn_tree->version = __atomic_add_fetch(&tree_versions, 1, __ATOMIC_RELAXED);
+
+	return rtn_tree;
+}
+
+//Return the name of the backend used by the given tree
+const char *tree_backend_name(tree *tree)
+{
+	return tree->ops->name;
 }
 
 //Delete the given tree
+//Erased nodes go back to the tree's pools after an epoch grace period, so
+//the calling thread's are reclaimed first. No other thread may still be
+//erasing from the tree
 void tree_delete(tree *tree)
 {
-	rb_delete(tree);
+	epoch_synchronize();
+	tree->ops->destroy(tree->impl);
+	ptr_hash_destroy(&tree->index);
+	pool_free(&tree_pool, tree);
 }
 
 
 //Given a tree, an address, and a length,
 //Insert a new node into the specified tree
 //that contains the given address and length attributes
-int node_insert(tree *tree, void *addr, int length)
+//Return the node stored in the tree, which stays valid until it is erased
+node *node_insert(tree *tree, void *addr, size_t length)
 {
-	int ret;
+	node *ret;
 
-	//Create a new node
-	node *ins_node;
-	ins_node = calloc(1, sizeof(node));
-
-	//Initialize values
-	ins_node->addr = addr;
-	ins_node->length = length;
-	ins_node->free_flag = 0;
+	//Initialize values, the tree copies them into its own node
+	node ins_node;
+	ins_node.addr = addr;
+	ins_node.length = length;
+	ins_node.free_flag = 0;
+	ins_node.site = 0;
 
 	//Insert the node into the tree
-	ret = rb_insert(tree, (void *)ins_node);
-	if (ret == 0)
+	ret = tree->ops->insert(tree->impl, &ins_node);
+	if (ret == NULL)
+	{
+		printf("failed to insert the node with mean %p and weight %zu\n", addr, length);
+		return NULL;
+	}
+
+	//Keep the hash index in sync with the backend
+	if (ptr_hash_put(&tree->index, addr, ret) != 0)
 	{
-		printf("failed to insert the node with mean %p and weight %d\n", addr, length);
-		free(ins_node);
+		printf("failed to index the node with mean %p\n", addr);
+		tree->ops->erase(tree->impl, addr);
+		return NULL;
+	}
+
+	tree->version = __atomic_add_fetch(&tree_versions, 1, __ATOMIC_RELAXED);
+
+	return ret;
+}
+
+//Given a tree and n nodes sorted by address, insert a copy of every node
+//in one ordered pass, so consecutive descents share the same path
+//out[i] is set to the stored copy of items[i], or NULL if it failed
+//Return 0 if every node was inserted, -1 otherwise
+int node_insert_batch(tree *tree, const node *items, size_t n, node **out)
+{
+	int ret = 0;
+
+	//Grow the hash index once for the whole batch
+	if (ptr_hash_reserve(&tree->index, n) != 0)
+	{
+		printf("failed to index %zu nodes\n", n);
 		return -1;
 	}
 
-	return 0;
+	for (size_t i = 0; i < n; i++)
+	{
+		node ins_node = items[i];
+
+		ins_node.free_flag = 0;
+		out[i] = tree->ops->insert(tree->impl, &ins_node);
+		if (out[i] == NULL)
+		{
+			printf("failed to insert the node with mean %p and weight %zu\n", items[i].addr, items[i].length);
+			ret = -1;
+			continue;
+		}
+
+		ptr_hash_put(&tree->index, items[i].addr, out[i]);
+	}
+
+	tree->version = __atomic_add_fetch(&tree_versions, 1, __ATOMIC_RELAXED);
+
+	return ret;
 }
 
 //Delete the node from the given tree that corresponds to the 
@@ -92,62 +425,160 @@ int node_insert(tree *tree, void *addr, int length)
 int tree_erase(tree *tree, void *addr)
 {
 	int ret;
-	node *erase_node;
 
-	erase_node = calloc(1, sizeof(node));
-	erase_node->addr = addr;
+	ptr_hash_remove(&tree->index, addr);
+	tree->version = __atomic_add_fetch(&tree_versions, 1, __ATOMIC_RELAXED);
 
-	ret = rb_erase(tree, (void *)erase_node);
+	ret = tree->ops->erase(tree->impl, addr);
 	if (ret == 0)
 	{
 		printf("failed to erase the node with mean %p\n", addr);
-		free(erase_node);
 		return -1;
 	}
 
 	return 0;
 }
 
-//Find the node in the given tree that corresponds to the given address
-node *tree_find(tree *tree, void *addr)
+//Delete the nodes of the given tree at n addresses sorted in ascending
+//order, in one ordered pass
+//Return 0 if every node was erased, -1 otherwise
+int tree_erase_batch(tree *tree, void **addrs, size_t n)
 {
-	//node_find will be passed and compared
-	//rtn_node will be assigned to the returned node
-	node *rtn_node, node_find;
+	int ret = 0;
 
-	//assign address to be compared
-	node_find.addr = addr;
+	tree->version = __atomic_add_fetch(&tree_versions, 1, __ATOMIC_RELAXED);
 
-	//Get matching node and return it
-	rtn_node = rb_find(tree, &node_find);
-	if (!rtn_node)
+	for (size_t i = 0; i < n; i++)
 	{
-		return NULL;
+		ptr_hash_remove(&tree->index, addrs[i]);
+
+		if (tree->ops->erase(tree->impl, addrs[i]) == 0)
+		{
+			printf("failed to erase the node with mean %p\n", addrs[i]);
+			ret = -1;
+		}
 	}
-	return rtn_node;
+
+	return ret;
+}
+
+//Find the node in the given tree that corresponds to the given address
+//Exact matches need no ordering, so they come from the hash index
+node *tree_find(tree *tree, void *addr)
+{
+	return ptr_hash_get(&tree->index, addr);
 }
 
 //Find the node in the given tree that corresponds
 //to the greatest address that is less than the given address
 //that has already been inserted into the tree
+//Queries close to this thread's last one are answered from its finger
+//without searching the tree
 node *tree_find_GLT(tree *tree, void *addr)
 {
-	node *rtn_node, node_find, *curr_high;
+	node *low, *high;
 
-	//Curr_high will be used to keep a running count of the 
-	//Highest address for comparison
-	curr_high = malloc(sizeof(node));
-	curr_high->addr = (void *)0x1;
+	if (finger.owner == tree && finger.version == tree->version)
+	{
+		//The address is still inside the last gap
+		if ((finger.low == NULL || finger.low->addr < addr) &&
+			(finger.high == NULL || addr <= finger.high->addr))
+		{
+			return finger.low;
+		}
+	}
 
-	//Assign address to be used for comparison. Returned node
-	//Must have an address that is less than this address
-	node_find.addr = addr;
-	rtn_node = rb_find_GLT(tree, &node_find, curr_high);
-	if (!rtn_node)
+	low = tree->ops->find_GLT(tree->impl, addr, &high);
+
+	finger.owner = tree;
+	finger.version = tree->version;
+	finger.low = low;
+	finger.high = high;
+
+	return low;
+}
+
+//Visit the nodes of the given tree in address order, starting at the first
+//node whose address is not less than from, until visit returns nonzero
+void tree_walk(tree *tree, void *from, tree_visit_f visit, void *arg)
+{
+	tree->ops->walk(tree->impl, from, visit, arg);
+}
+
+//State of an overlap query, passed through the walk
+typedef struct overlap_query
+{
+	void *hi;
+	tree_visit_f visit;
+	void *arg;
+} overlap_query;
+
+//Report a node that starts inside the window, stopping at the first one
+//that starts at or past its end
+static int overlap_visit(node *visited, void *arg)
+{
+	overlap_query *query = arg;
+
+	if (visited->addr >= query->hi)
 	{
-		return NULL;
+		return 1;
 	}
-	return rtn_node;
+
+	return query->visit(visited, query->arg);
+}
+
+//Visit, in address order, every node of set whose block intersects the
+//window [lo, hi), until visit returns nonzero. find_GLT and walk search set
+//Live blocks never overlap one another, so only the block before lo can
+//reach into the window and every other match starts inside it. The query
+//costs one search plus one step per node reported
+void tree_find_overlapping_in(void *set, tree_glt_f find_GLT, tree_walk_f walk, void *lo, void *hi, tree_visit_f visit, void *arg)
+{
+	overlap_query query;
+	node *before;
+
+	if (lo >= hi)
+	{
+		return;
+	}
+
+	before = find_GLT(set, lo);
+	if (before != NULL && (char *)before->addr + before->length > (char *)lo)
+	{
+		if (visit(before, arg))
+		{
+			return;
+		}
+	}
+
+	query.hi = hi;
+	query.visit = visit;
+	query.arg = arg;
+	walk(set, lo, overlap_visit, &query);
+}
+
+//tree_find_GLT and tree_walk in the form tree_find_overlapping_in takes
+static node *tree_glt(void *set, void *addr)
+{
+	return tree_find_GLT(set, addr);
+}
+
+static void tree_walk_set(void *set, void *from, tree_visit_f visit, void *arg)
+{
+	tree_walk(set, from, visit, arg);
+}
+
+//Visit, in address order, every node of the given tree whose block
+//intersects the window [lo, hi), until visit returns nonzero
+void tree_find_overlapping(tree *tree, void *lo, void *hi, tree_visit_f visit, void *arg)
+{
+	tree_find_overlapping_in(tree, tree_glt, tree_walk_set, lo, hi, visit, arg);
+}
+
+//Return the number of nodes in the given tree
+size_t tree_size(tree *tree)
+{
+	return tree->ops->size(tree->impl);
 }
 
 //Return 1 if the address has been freed already
@@ -175,11 +606,10 @@ void node_setfree(tree *tree, void *addr, int setVal)
 //Given a tree and address, return the length associated with the given address
 int node_get_length(tree *tree, void *addr)
 {
-	node *rtn_node, node_find;
+	node *rtn_node;
 
 	//Find the node as with tree_find
-	node_find.addr = addr;
-	rtn_node = rb_find(tree, &node_find);
+	rtn_node = tree_find(tree, addr);
 	if (!rtn_node)
 	{
 		return 0;
@@ -189,23 +619,21 @@ int node_get_length(tree *tree, void *addr)
 	return rtn_node->length;
 }
 
-//Traverse the given tree and print each nodes address and length 
-void tree_print(tree *tree)
+//Print one node, used by tree_print
+static int print_node(node *visited, void *arg)
 {
-	int index = 0;
-	node *rtn_node;
+	int *index = arg;
 
-	rb_trav_t *rbtrav;
-	rbtrav = rb_tnew();
+	printf("Index: %d Address: %p Length: %zu\n", *index, visited->addr, visited->length);
+	(*index)++;
 
-	rtn_node = rb_tfirst(rbtrav, tree);
-	printf("Index: %d Address: %p Length: %ld\n", index, rtn_node->addr, rtn_node->length);
+	return 0;
+}
 
-	index++;
+//Traverse the given tree and print each nodes address and length 
+void tree_print(tree *tree)
+{
+	int index = 0;
 
-	while ((rtn_node = rb_tnext(rbtrav)) != NULL)
-	{
-		printf("Index: %d Address: %p Length: %ld\n", index, rtn_node->addr, rtn_node->length);
-		index++;
-	}
+	tree_walk(tree, NULL, print_node, &index);
 }
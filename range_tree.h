@@ -1,16 +1,53 @@
 #ifndef RANGE_TREE_H
 #define RANGE_TREE_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 //Tree Node Structure
 typedef struct node
 {
 	void *addr;
 	size_t length;
 	int free_flag;
+	uint32_t site;
+	//Allocations the block stands for, set along with site when sampled
+	float weight;
 
 } node;
 
-typedef struct rb_tree tree;
+//Called for each node visited by tree_walk, return nonzero to stop the walk
+typedef int (*tree_visit_f)(node *visited, void *arg);
+
+//Predecessor search and ordered walk of a set of nodes kept outside a
+//tree, so tree_find_overlapping_in can query it like a tree
+typedef node *(*tree_glt_f)(void *set, void *addr);
+typedef void (*tree_walk_f)(void *set, void *from, tree_visit_f visit, void *arg);
+
+//Operations provided by every index backend. impl is the backend's own tree,
+//and nodes returned by insert stay valid until they are erased. find_GLT also
+//sets next to the smallest node whose address is not less than addr
+typedef struct tree_ops
+{
+	const char *name;
+	void *(*create)();
+	void (*destroy)(void *impl);
+	node *(*insert)(void *impl, node *data);
+	int (*erase)(void *impl, void *addr);
+	node *(*find)(void *impl, void *addr);
+	node *(*find_GLT)(void *impl, void *addr, node **next);
+	void (*walk)(void *impl, void *from, tree_visit_f visit, void *arg);
+	size_t (*size)(void *impl);
+
+} tree_ops;
+
+typedef struct tree tree;
+
+//Environment variable naming the backend used by tree_create
+#define TREE_BACKEND_ENV "MALLOC537_INDEX"
+
+//Backend used when none is named
+#define TREE_DEFAULT_BACKEND "rb"
 
 //Tree Functions
 int node_cmp(const void *p1, const void *p2);
@@ -19,18 +56,38 @@ void *node_duplicate(void *p);
 
 void node_free(void *p);
 
+const tree_ops *tree_backend(const char *name);
+
 tree *tree_create();
 
+tree *tree_create_backend(const char *name);
+
+tree *tree_create_ops(const tree_ops *ops);
+
+const char *tree_backend_name(tree *tree);
+
 void tree_delete(tree *tree);
 
-int node_insert(tree *tree, void *addr, int length);
+node *node_insert(tree *tree, void *addr, size_t length);
+
+int node_insert_batch(tree *tree, const node *items, size_t n, node **out);
 
 int tree_erase(tree *tree, void *addr);
 
+int tree_erase_batch(tree *tree, void **addrs, size_t n);
+
 node *tree_find(tree *tree, void *addr);
 
 node *tree_find_GLT(tree *tree, void *addr);
 
+void tree_walk(tree *tree, void *from, tree_visit_f visit, void *arg);
+
+void tree_find_overlapping(tree *tree, void *lo, void *hi, tree_visit_f visit, void *arg);
+
+void tree_find_overlapping_in(void *set, tree_glt_f find_GLT, tree_walk_f walk, void *lo, void *hi, tree_visit_f visit, void *arg);
+
+size_t tree_size(tree *tree);
+
 int node_isfree(tree *tree, void *addr);
 
 void node_setfree(tree *tree, void *addr, int setVal);
@@ -40,4 +97,4 @@ int node_get_length(tree *tree, void *addr);
 void tree_print(tree *tree);
 
 
-#endif
\ No newline at end of file
+#endif
@@ -1,6 +1,8 @@
 #include "rb_tree.h"
+#include "pool.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #ifndef HEIGHT_LIMIT
 #define HEIGHT_LIMIT 64       /* Tallest allowable tree */
@@ -20,6 +22,9 @@ struct rb_tree
   dup_f dup;          /* Clone an item (user-defined) */
   rel_f rel;          /* Destroy an item (user-defined) */
   size_t size;        /* Number of items (user-defined) */
+
+  size_t data_size;   /* Bytes of item data inside each node (intrusive) */
+  pool nodes;         /* Node storage, item data included if intrusive */
 };
 
 struct rb_trav
@@ -30,6 +35,10 @@ struct rb_trav
   size_t top;                       /* Top of stack */
 };
 
+/* Tree headers and traversal objects come from pools, not the heap */
+static pool tree_pool = POOL_INITIALIZER(sizeof(rb_tree_t));
+static pool trav_pool = POOL_INITIALIZER(sizeof(rb_trav_t));
+
 /**
   <summary>
   Checks the color of a red black node
@@ -55,24 +64,15 @@ static int is_red(rb_node_t *root)
 */
 static rb_node_t *rotate_single(rb_node_t *root, int dir)
 {
+  rb_node_t *save = root->link[!dir];
 
-  if (root->link != NULL)
-  {
-    rb_node_t *save = root->link[!dir];
-
-    root->link[!dir] = save->link[dir];
-    save->link[dir] = root;
+  root->link[!dir] = save->link[dir];
+  save->link[dir] = root;
 
-    root->red = 1;
-    save->red = 0;
+  root->red = 1;
+  save->red = 0;
 
-    return save;
-  }
-
-  else
-  {
-    return NULL;
-  }
+  return save;
 }
 
 /**
@@ -87,10 +87,8 @@ static rb_node_t *rotate_single(rb_node_t *root, int dir)
 */
 static rb_node_t *rotate_double(rb_node_t *root, int dir)
 {
-  if (root->link != NULL)
-  {
-    root->link[!dir] = rotate_single(root->link[!dir], !dir);
-  }
+  root->link[!dir] = rotate_single(root->link[!dir], !dir);
+
   return rotate_single(root, dir);
 }
 
@@ -103,25 +101,57 @@ static rb_node_t *rotate_double(rb_node_t *root, int dir)
   <param name="data">The data value that will be stored in this node</param>
   <returns>A pointer to the new node</returns>
   <remarks>
-  For rb_tree.c internal use only. The data for this node must
-  be freed using the same tree's rel function. The returned pointer
-  must be freed using C's free function
+  For rb_tree.c internal use only. Nodes come from the tree's pool.
+  In intrusive mode the data is copied into the node itself, otherwise
+  it must be freed using the same tree's rel function. Either way the
+  node must be released with release_node
   </remarks>
 */
 static rb_node_t *new_node(rb_tree_t *tree, void *data)
 {
-  rb_node_t *retNode = (rb_node_t *)malloc(sizeof *retNode);
+  rb_node_t *retNode = (rb_node_t *)pool_alloc(&tree->nodes);
 
   if (retNode == NULL)
     return NULL;
 
+  if (tree->data_size != 0)
+  {
+    /* Item data lives directly after the node header */
+    retNode->data = retNode + 1;
+    memcpy(retNode->data, data, tree->data_size);
+  }
+  else
+  {
+    retNode->data = tree->dup(data);
+  }
+
   retNode->red = 1;
-  retNode->data = tree->dup(data);
   retNode->link[0] = retNode->link[1] = NULL;
 
   return retNode;
 }
 
+/**
+  <summary>
+  Releases a node and its data that is no longer part of a tree
+  <summary>
+  <param name="tree">The red black tree the node was created for</param>
+  <param name="node">The node to release</param>
+  <remarks>For rb_tree.c internal use only</remarks>
+*/
+static void release_node(rb_tree_t *tree, rb_node_t *node)
+{
+  if (tree->data_size == 0)
+  {
+    tree->rel(node->data);
+    pool_free(&tree->nodes, node);
+    return;
+  }
+
+  /* Intrusive items may still be read by epoch readers */
+  pool_retire(&tree->nodes, node);
+}
+
 /**
   <summary>
   Creates and initializes an empty red black tree with
@@ -138,7 +168,7 @@ static rb_node_t *new_node(rb_tree_t *tree, void *data)
 rb_tree_t *rb_new(cmp_f cmp, dup_f dup, rel_f rel)
 {
   //Allocate space for a new tree
-  rb_tree_t *rtn_tree = (rb_tree_t *)malloc(sizeof *rtn_tree);
+  rb_tree_t *rtn_tree = (rb_tree_t *)pool_alloc(&tree_pool);
 
   if (rtn_tree == NULL)
     return NULL;
@@ -150,6 +180,36 @@ rb_tree_t *rb_new(cmp_f cmp, dup_f dup, rel_f rel)
   rtn_tree->rel = rel;
   rtn_tree->size = 0;
 
+  rtn_tree->data_size = 0;
+  pool_init(&rtn_tree->nodes, sizeof(rb_node_t));
+
+  return rtn_tree;
+}
+
+/**
+  <summary>
+  Creates and initializes an empty intrusive red black tree.
+  Each item is copied into the tree node that holds it, so an
+  insertion costs a single pool allocation and no dup call
+  <summary>
+  <param name="cmp">User-defined data comparison function</param>
+  <param name="data_size">Size in bytes of one item</param>
+  <returns>A pointer to the new tree</returns>
+  <remarks>
+  The returned pointer must be released with rb_delete. Data
+  pointers returned by the tree stay valid until that item is erased
+  </remarks>
+*/
+rb_tree_t *rb_new_intrusive(cmp_f cmp, size_t data_size)
+{
+  rb_tree_t *rtn_tree = rb_new(cmp, NULL, NULL);
+
+  if (rtn_tree == NULL)
+    return NULL;
+
+  rtn_tree->data_size = data_size;
+  pool_init(&rtn_tree->nodes, sizeof(rb_node_t) + data_size);
+
   return rtn_tree;
 }
 
@@ -170,16 +230,16 @@ void rb_delete(rb_tree_t *tree)
   /*
     Rotate away the left links so that
     we can treat this like the destruction
-    of a linked list
+    of a linked list. Intrusive items need
+    no release, their nodes go with the pool
   */
-  while (curr != NULL)
+  while (curr != NULL && tree->data_size == 0)
   {
     if (curr->link[0] == NULL)
     {
-      /* No left links, just kill the node and move on */
+      /* No left links, just kill the data and move on */
       save = curr->link[1];
       tree->rel(curr->data);
-      free(curr);
     }
     else
     {
@@ -192,7 +252,8 @@ void rb_delete(rb_tree_t *tree)
     curr = save;
   }
 
-  free(tree);
+  pool_destroy(&tree->nodes);
+  pool_free(&tree_pool, tree);
 }
 
 /**
@@ -229,37 +290,32 @@ void *rb_find(rb_tree_t *tree, void *data)
 }
 
 //Returns node of tree that is Greatest Less Than the given address
-void *rb_find_GLT(rb_tree_t *tree, void *data, void *curr_high)
+//If next is not NULL it is set to the smallest node that is not less than
+//the given address, so the caller knows the range the answer holds for
+void *rb_find_GLT(rb_tree_t *tree, void *data, void **next)
 {
   rb_node_t *curr = tree->root;
-  int found_highest = 0;
+  void *low = NULL, *high = NULL;
 
+  /* One comparison per level: go right past smaller items, left otherwise */
   while (curr != NULL)
   {
-    if (tree->cmp(curr->data, curr_high) == 1 && (tree->cmp(data, curr->data) == 1))
-    {
-      curr_high = curr->data;
-      found_highest = 1;
-    }
-
-    if (tree->cmp(curr->data, data) == 1)
+    if (tree->cmp(curr->data, data) < 0)
     {
-      curr = curr->link[0];
+      low = curr->data;
+      curr = curr->link[1];
     }
     else
     {
-      curr = curr->link[1];
+      high = curr->data;
+      curr = curr->link[0];
     }
   }
 
-  if (found_highest == 0)
-  {
-    return NULL;
-  }
-  else
-  {
-    return curr_high;
-  }
+  if (next != NULL)
+    *next = high;
+
+  return low;
 }
 
 /**
@@ -270,22 +326,27 @@ void *rb_find_GLT(rb_tree_t *tree, void *data, void *curr_high)
   <param name="tree">The tree to insert into</param>
   <param name="data">The data value to insert</param>
   <returns>
-  1 if the value was inserted successfully,
-  0 if the insertion failed for any reason
+  A pointer to the copy stored in the tree,
+  or a null pointer if the insertion failed for any reason
   </returns>
+  <remarks>
+  Data that compares equal to an item already in the tree is not inserted
+  </remarks>
 */
-int rb_insert(rb_tree_t *tree, void *data)
+void *rb_insert_data(rb_tree_t *tree, void *data)
 {
+  rb_node_t *inserted = NULL;
+
   if (tree->root == NULL)
   {
     /*
       We have an empty tree; attach the
       new node directly to the root
     */
-    tree->root = new_node(tree, data);
+    tree->root = inserted = new_node(tree, data);
 
     if (tree->root == NULL)
-      return 0;
+      return NULL;
   }
   else
   {
@@ -306,10 +367,10 @@ int rb_insert(rb_tree_t *tree, void *data)
       if (itrParent == NULL)
       {
         /* Insert a new node at the first null link */
-        iterator->link[dir] = itrParent = new_node(tree, data);
+        iterator->link[dir] = itrParent = inserted = new_node(tree, data);
 
         if (itrParent == NULL)
-          return 0;
+          return NULL;
       }
       else if (is_red(itrParent->link[0]) && is_red(itrParent->link[1]))
       {
@@ -354,9 +415,30 @@ int rb_insert(rb_tree_t *tree, void *data)
 
   /* Make the root black for simplified logic */
   tree->root->red = 0;
+
+  if (inserted == NULL)
+    return NULL;
+
   ++tree->size;
 
-  return 1;
+  return inserted->data;
+}
+
+/**
+  <summary>
+  Insert a copy of the user-specified
+  data into a red black tree
+  <summary>
+  <param name="tree">The tree to insert into</param>
+  <param name="data">The data value to insert</param>
+  <returns>
+  1 if the value was inserted successfully,
+  0 if the insertion failed for any reason
+  </returns>
+*/
+int rb_insert(rb_tree_t *tree, void *data)
+{
+  return rb_insert_data(tree, data) != NULL;
 }
 
 /**
@@ -446,14 +528,36 @@ int rb_erase(rb_tree_t *tree, void *data)
       }
     }
 
-    /* Replace and remove the saved node */
+    /* Remove the saved node */
     if (found != NULL)
     {
-      tree->rel(found->data);
-      found->data = curr->data;
       temp1->link[temp1->link[1] == curr] =
           curr->link[curr->link[0] == NULL];
-      free(curr);
+
+      /*
+        Move the unlinked node into the saved node's place
+        instead of moving the data, so that data pointers
+        (the nodes themselves in intrusive mode) stay valid
+      */
+      if (found != curr)
+      {
+        rb_node_t *parent = &head;
+        int pdir = 1;
+
+        while (parent->link[pdir] != found)
+        {
+          parent = parent->link[pdir];
+          pdir = tree->cmp(parent->data, found->data) < 0;
+        }
+
+        curr->red = found->red;
+        curr->link[0] = found->link[0];
+        curr->link[1] = found->link[1];
+        parent->link[pdir] = curr;
+      }
+
+      release_node(tree, found);
+      --tree->size;
     }
 
     /* Update the root (it may be different) */
@@ -463,10 +567,10 @@ int rb_erase(rb_tree_t *tree, void *data)
     if (tree->root != NULL)
       tree->root->red = 0;
 
-    --tree->size;
+    return found != NULL;
   }
 
-  return 1;
+  return 0;
 }
 
 /**
@@ -494,7 +598,7 @@ size_t rb_size(rb_tree_t *tree)
 */
 rb_trav_t *rb_tnew(void)
 {
-  return (rb_trav_t *)malloc(sizeof(rb_trav_t));
+  return (rb_trav_t *)pool_alloc(&trav_pool);
 }
 
 /**
@@ -508,7 +612,7 @@ rb_trav_t *rb_tnew(void)
 */
 void rb_tdelete(rb_trav_t *trav)
 {
-  free(trav);
+  pool_free(&trav_pool, trav);
 }
 
 /**
@@ -605,6 +709,48 @@ void *rb_tfirst(rb_trav_t *trav, rb_tree_t *tree)
   return start(trav, tree, 0); /* Min value */
 }
 
+/**
+  <summary>
+  Initialize a traversal object to the smallest node
+  that is not less than the user-specified data
+  <summary>
+  <param name="trav">The traversal object to initialize</param>
+  <param name="tree">The tree that the object will be attached to</param>
+  <param name="data">The data value to seek to</param>
+  <returns>A pointer to that data value, or NULL if every value is less</returns>
+*/
+void *rb_tseek(rb_trav_t *trav, rb_tree_t *tree, void *data)
+{
+  rb_node_t *node = tree->root;
+  size_t found_top = 0;
+
+  trav->tree = tree;
+  trav->curr = NULL;
+  trav->top = 0;
+
+  /*
+    Every node on the way down is saved; the path of the
+    last candidate is the prefix saved before reaching it
+  */
+  while (node != NULL)
+  {
+    int dir = tree->cmp(node->data, data) < 0;
+
+    if (!dir)
+    {
+      trav->curr = node;
+      found_top = trav->top;
+    }
+
+    trav->path[trav->top++] = node;
+    node = node->link[dir];
+  }
+
+  trav->top = found_top;
+
+  return trav->curr == NULL ? NULL : trav->curr->data;
+}
+
 /**
   <summary>
   Initialize a traversal object to the largest valued node
@@ -15,10 +15,12 @@ typedef void  (*rel_f) ( void *p );
 
 /* Red Black tree functions */
 rb_tree_t *rb_new ( cmp_f cmp, dup_f dup, rel_f rel);
+rb_tree_t *rb_new_intrusive ( cmp_f cmp, size_t data_size );
 void          rb_delete ( rb_tree_t *tree );
 void         *rb_find ( rb_tree_t *tree, void *data );
-void         *rb_find_GLT(rb_tree_t *tree, void *data, void* curr_high);
+void         *rb_find_GLT ( rb_tree_t *tree, void *data, void **next );
 int           rb_insert ( rb_tree_t *tree, void *data );
+void         *rb_insert_data ( rb_tree_t *tree, void *data );
 int           rb_erase ( rb_tree_t *tree, void *data );
 size_t        rb_size ( rb_tree_t *tree );
 
@@ -26,6 +28,7 @@ size_t        rb_size ( rb_tree_t *tree );
 rb_trav_t    *rb_tnew ( void );
 void          rb_tdelete ( rb_trav_t *trav );
 void         *rb_tfirst ( rb_trav_t *trav, rb_tree_t *tree );
+void         *rb_tseek ( rb_trav_t *trav, rb_tree_t *tree, void *data );
 void         *rb_tlast ( rb_trav_t *trav, rb_tree_t *tree );
 void         *rb_tnext ( rb_trav_t *trav );
 void         *rb_tprev ( rb_trav_t *trav );
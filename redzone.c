@@ -0,0 +1,59 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "poison.h"
+#include "redzone.h"
+
+//Redzones around each block: the block is allocated REDZONE_SIZE bytes
+//bigger on each side and both pads are filled with a canary. Nothing is
+//instrumented, an overflow is found when the canary is next compared by
+//the poison kernels
+
+//Fill the redzones of a size byte block whose padded allocation starts at
+//base, see redzone_padded. Return the block's address
+void *redzone_wrap(void *base, size_t size)
+{
+	unsigned char *ptr = (unsigned char *)base + REDZONE_SIZE;
+
+	poison_fill(base, REDZONE_SIZE, REDZONE_CANARY);
+	poison_fill(ptr + size, REDZONE_SIZE, REDZONE_CANARY);
+
+	return ptr;
+}
+
+//Return the start of the padded allocation holding the block at ptr
+void *redzone_base(void *ptr)
+{
+	return (unsigned char *)ptr - REDZONE_SIZE;
+}
+
+//Return the bytes to allocate for a size byte block and its redzones, or
+//0 if that overflows
+size_t redzone_padded(size_t size)
+{
+	if (size > SIZE_MAX - 2 * REDZONE_SIZE)
+	{
+		return 0;
+	}
+
+	return size + 2 * REDZONE_SIZE;
+}
+
+//Compare both redzones of the size byte block at ptr with the canary
+//Return 0 if they are intact, otherwise REDZONE_FRONT and/or REDZONE_BACK
+int redzone_check(void *ptr, size_t size)
+{
+	int ret = 0;
+
+	if (!poison_intact(redzone_base(ptr), REDZONE_SIZE, REDZONE_CANARY))
+	{
+		ret |= REDZONE_FRONT;
+	}
+	if (!poison_intact((unsigned char *)ptr + size, REDZONE_SIZE, REDZONE_CANARY))
+	{
+		ret |= REDZONE_BACK;
+	}
+
+	return ret;
+}
@@ -0,0 +1,29 @@
+#ifndef REDZONE_H
+#define REDZONE_H
+
+#include <stddef.h>
+
+//Environment variable that turns redzones on when set to anything but "0"
+#define REDZONE_ENV "MALLOC537_REDZONES"
+
+//Bytes of canary before and after each block. A multiple of 16, so blocks
+//keep malloc's alignment
+#define REDZONE_SIZE 16
+
+//Byte every redzone is filled with
+#define REDZONE_CANARY 0xCB
+
+//Which redzones of a block have been overwritten
+#define REDZONE_FRONT 1
+#define REDZONE_BACK 2
+
+//Redzone Functions
+void *redzone_wrap(void *base, size_t size);
+
+void *redzone_base(void *ptr);
+
+size_t redzone_padded(size_t size);
+
+int redzone_check(void *ptr, size_t size);
+
+#endif
@@ -0,0 +1,100 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include "sampler.h"
+
+//Poisson sampling by bytes: sample points fall on the stream of allocated
+//bytes at exponentially distributed gaps with a mean of the interval, so
+//an allocation of size bytes is sampled with probability
+//1 - exp(-size / interval). Each thread counts down the bytes to its next
+//sample point, and a sampled allocation is weighted by the inverse of its
+//probability so totals built from samples are unbiased estimates
+
+__thread long sample_left;
+
+//Per thread generator state, and whether the countdown has been drawn
+static __thread uint64_t sample_rng;
+static __thread int sample_armed;
+
+static size_t interval;
+
+//Draw the bytes to the next sample point
+static long sample_gap(size_t mean)
+{
+	double u;
+
+	if (sample_rng == 0)
+	{
+		sample_rng = ((uintptr_t)&sample_rng * 0x9E3779B97F4A7C15ULL) | 1;
+	}
+
+	//xorshift64*, taking 53 bits for a uniform draw in (0, 1]
+	sample_rng ^= sample_rng >> 12;
+	sample_rng ^= sample_rng << 25;
+	sample_rng ^= sample_rng >> 27;
+	u = (double)(((sample_rng * 0x2545F4914F6CDD1DULL) >> 11) + 1) / 9007199254740992.0;
+
+	return (long)(-log(u) * (double)mean) + 1;
+}
+
+//Sample with a mean of bytes between samples, 0 to record every
+//allocation. Each thread picks the new interval up at its next sample
+void sample_set_interval(size_t bytes)
+{
+	__atomic_store_n(&interval, bytes, __ATOMIC_RELAXED);
+}
+
+//Return the mean bytes between samples, 0 if every allocation is recorded
+size_t sample_interval()
+{
+	return __atomic_load_n(&interval, __ATOMIC_RELAXED);
+}
+
+//Called when SAMPLE_SKIP found the countdown of an allocation of size
+//bytes has run out. Draws the next countdown, and sets weight to the
+//number of allocations the sampled one stands for
+//Return 1 if the allocation is sampled, 0 if it is not
+int sample_take(size_t size, double *weight)
+{
+	size_t mean = sample_interval();
+
+	if (mean == 0)
+	{
+		sample_left = 0;
+		sample_armed = 0;
+		*weight = 1;
+		return 1;
+	}
+
+	//A thread's first countdown starts at its first allocation
+	if (!sample_armed)
+	{
+		sample_armed = 1;
+		sample_left = sample_gap(mean) - (long)size;
+		if (sample_left > 0)
+		{
+			return 0;
+		}
+	}
+
+	sample_left = sample_gap(mean);
+	*weight = sample_weight(size);
+
+	return 1;
+}
+
+//Return the number of allocations of size bytes a sampled one stands for
+//at the current interval, 1 if every allocation is recorded
+double sample_weight(size_t size)
+{
+	size_t mean = sample_interval();
+
+	if (mean == 0)
+	{
+		return 1;
+	}
+
+	return 1 / -expm1(-(double)(size > 0 ? size : 1) / (double)mean);
+}
@@ -0,0 +1,26 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <stddef.h>
+
+//Environment variable holding the mean bytes allocated between samples,
+//0 (the default) records every allocation
+#define SAMPLE_INTERVAL_ENV "MALLOC537_SAMPLE_INTERVAL"
+
+//Bytes the calling thread may still allocate before its next sample
+extern __thread long sample_left;
+
+//Nonzero if an allocation of size bytes is not sampled. The whole cost of
+//an unsampled allocation: one subtraction and one branch
+#define SAMPLE_SKIP(size) ((sample_left -= (long)(size)) > 0)
+
+//Sampler Functions
+void sample_set_interval(size_t bytes);
+
+size_t sample_interval();
+
+int sample_take(size_t size, double *weight);
+
+double sample_weight(size_t size);
+
+#endif
@@ -0,0 +1,204 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include "shadow.h"
+
+//Shadow map from address granules to the record that owns them.
+//A three level page table: the top level is static, the middle level
+//tables and the leaves are mmap'd the first time a granule under them is set,
+//so a lookup is always three dependent loads
+static void **shadow_top[1UL << SHADOW_TOP_BITS];
+static size_t mapped_bytes;
+
+//Map a zero filled table of the given number of pointers
+static void *table_map(size_t entries)
+{
+	size_t bytes = entries * sizeof(void *);
+	void *table = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+	if (table == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	__atomic_fetch_add(&mapped_bytes, bytes, __ATOMIC_RELAXED);
+	return table;
+}
+
+//Unmap a table that lost the race to be installed
+static void table_unmap(void *table, size_t entries)
+{
+	size_t bytes = entries * sizeof(void *);
+
+	munmap(table, bytes);
+	__atomic_fetch_sub(&mapped_bytes, bytes, __ATOMIC_RELAXED);
+}
+
+//Install a freshly mapped table in *slot unless another thread got there
+//first. Return the table now in *slot
+static void *table_install(void **slot, size_t entries)
+{
+	void *expected = NULL;
+	void *table = table_map(entries);
+
+	if (table == NULL)
+	{
+		return __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+	}
+
+	if (!__atomic_compare_exchange_n(slot, &expected, table, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+	{
+		table_unmap(table, entries);
+		return expected;
+	}
+
+	return table;
+}
+
+//Return the leaf covering the given granule index, mapping the tables on the
+//way down if create is set. Return NULL if there is none
+static void **leaf_get(uintptr_t granule, int create)
+{
+	uintptr_t top = granule >> (SHADOW_LEAF_BITS + SHADOW_MID_BITS);
+	uintptr_t mid = (granule >> SHADOW_LEAF_BITS) & ((1UL << SHADOW_MID_BITS) - 1);
+	void **mid_table = __atomic_load_n(&shadow_top[top], __ATOMIC_ACQUIRE);
+	void **leaf;
+
+	//Threads may race to map the same table, the loser unmaps its copy
+	if (mid_table == NULL)
+	{
+		if (!create || (mid_table = table_install((void **)&shadow_top[top], 1UL << SHADOW_MID_BITS)) == NULL)
+		{
+			return NULL;
+		}
+	}
+
+	leaf = __atomic_load_n((void ***)&mid_table[mid], __ATOMIC_ACQUIRE);
+	if (leaf == NULL && create)
+	{
+		leaf = table_install(&mid_table[mid], 1UL << SHADOW_LEAF_BITS);
+	}
+
+	return leaf;
+}
+
+//Record owner as the owner of every granule in [addr, addr + length)
+//Return 0 on success, -1 if the range cannot be shadowed (the start is not
+//granule aligned, the range is empty or out of range, or mapping failed)
+int shadow_set(void *addr, size_t length, void *owner)
+{
+	uintptr_t start = (uintptr_t)addr;
+	uintptr_t granule, last;
+
+	if (length == 0 || (start & (SHADOW_GRANULE - 1)) != 0 ||
+		start + length < start || ((start + length - 1) >> SHADOW_ADDR_BITS) != 0)
+	{
+		return -1;
+	}
+
+	granule = start >> SHADOW_GRANULE_SHIFT;
+	last = (start + length - 1) >> SHADOW_GRANULE_SHIFT;
+
+	//Fill one leaf at a time
+	while (granule <= last)
+	{
+		void **leaf = leaf_get(granule, 1);
+		uintptr_t index = granule & ((1UL << SHADOW_LEAF_BITS) - 1);
+		uintptr_t count = (1UL << SHADOW_LEAF_BITS) - index;
+
+		if (leaf == NULL)
+		{
+			return -1;
+		}
+
+		if (count > last - granule + 1)
+		{
+			count = last - granule + 1;
+		}
+
+		for (uintptr_t i = 0; i < count; i++)
+		{
+			leaf[index + i] = owner;
+		}
+
+		granule += count;
+	}
+
+	return 0;
+}
+
+//Forget the granules in [addr, addr + length) that are still owned by owner,
+//leaving any granule since claimed by a neighbouring block alone
+void shadow_clear(void *addr, size_t length, void *owner)
+{
+	uintptr_t start = (uintptr_t)addr;
+	uintptr_t granule, last;
+
+	if (length == 0 || start + length < start || ((start + length - 1) >> SHADOW_ADDR_BITS) != 0)
+	{
+		return;
+	}
+
+	granule = start >> SHADOW_GRANULE_SHIFT;
+	last = (start + length - 1) >> SHADOW_GRANULE_SHIFT;
+
+	while (granule <= last)
+	{
+		void **leaf = leaf_get(granule, 0);
+		uintptr_t index = granule & ((1UL << SHADOW_LEAF_BITS) - 1);
+		uintptr_t count = (1UL << SHADOW_LEAF_BITS) - index;
+
+		if (count > last - granule + 1)
+		{
+			count = last - granule + 1;
+		}
+
+		if (leaf != NULL)
+		{
+			for (uintptr_t i = 0; i < count; i++)
+			{
+				if (leaf[index + i] == owner)
+				{
+					leaf[index + i] = NULL;
+				}
+			}
+		}
+
+		granule += count;
+	}
+}
+
+//Return the owner recorded for the granule holding addr, or NULL if none
+//The caller must still check that addr lies inside the owner's block
+void *shadow_find(void *addr)
+{
+	uintptr_t granule = (uintptr_t)addr >> SHADOW_GRANULE_SHIFT;
+	void **mid_table, **leaf;
+
+	if (((uintptr_t)addr >> SHADOW_ADDR_BITS) != 0)
+	{
+		return NULL;
+	}
+
+	mid_table = __atomic_load_n(&shadow_top[granule >> (SHADOW_LEAF_BITS + SHADOW_MID_BITS)], __ATOMIC_ACQUIRE);
+	if (mid_table == NULL)
+	{
+		return NULL;
+	}
+
+	leaf = __atomic_load_n((void ***)&mid_table[(granule >> SHADOW_LEAF_BITS) & ((1UL << SHADOW_MID_BITS) - 1)], __ATOMIC_ACQUIRE);
+	if (leaf == NULL)
+	{
+		return NULL;
+	}
+
+	return __atomic_load_n(&leaf[granule & ((1UL << SHADOW_LEAF_BITS) - 1)], __ATOMIC_RELAXED);
+}
+
+//Return the number of bytes mapped for shadow tables
+size_t shadow_mapped_bytes()
+{
+	return __atomic_load_n(&mapped_bytes, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,28 @@
+#ifndef SHADOW_H
+#define SHADOW_H
+
+#include <stddef.h>
+
+//Each shadow entry covers one granule of 16 bytes, the alignment of every
+//block returned by malloc
+#define SHADOW_GRANULE_SHIFT 4
+#define SHADOW_GRANULE (1UL << SHADOW_GRANULE_SHIFT)
+
+//Only user space addresses below 2^48 are shadowed
+#define SHADOW_ADDR_BITS 48
+
+//Granule index bits resolved by each of the three levels
+#define SHADOW_LEAF_BITS 18
+#define SHADOW_MID_BITS 13
+#define SHADOW_TOP_BITS (SHADOW_ADDR_BITS - SHADOW_GRANULE_SHIFT - SHADOW_LEAF_BITS - SHADOW_MID_BITS)
+
+//Shadow Map Functions
+int shadow_set(void *addr, size_t length, void *owner);
+
+void shadow_clear(void *addr, size_t length, void *owner);
+
+void *shadow_find(void *addr);
+
+size_t shadow_mapped_bytes();
+
+#endif
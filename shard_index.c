@@ -0,0 +1,528 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "range_tree.h"
+#include "shard_index.h"
+
+//One shard: a tree of its own behind its own lock, alone on its cache line
+//seq is odd while a writer holding the lock changes the tree, so exact
+//lookups can run without the lock and retry if a write overlapped them
+typedef struct shard
+{
+	pthread_mutex_t lock;
+	unsigned long seq;
+	tree *tree;
+
+} __attribute__((aligned(64))) shard;
+
+//A tracking index split by address into shards, so threads working in
+//different regions never wait for one another
+//Bit r of occupied is set while region r may hold nodes, and bit w of
+//summary once word w of occupied may be nonzero, so a lookup that misses
+//in its own region finds the nearest earlier one without probing shards
+struct shard_index
+{
+	shard shards[SHARD_COUNT];
+	size_t count;
+	uint64_t occupied[SHARD_REGIONS / 64];
+	uint64_t summary[SHARD_REGIONS / 64 / 64];
+};
+
+//A run of one shard's nodes, copied out under its lock so visit functions
+//run without holding it
+typedef struct walk_batch
+{
+	uintptr_t region;
+	size_t n;
+	node nodes[SHARD_WALK_BATCH];
+} walk_batch;
+
+//Return the region holding addr
+static uintptr_t region_of(void *addr)
+{
+	return (uintptr_t)addr >> SHARD_REGION_SHIFT;
+}
+
+//Return the shard holding the given region. Neighbouring regions are
+//spread over the shards by a multiplicative hash
+static shard *shard_of(shard_index *index, uintptr_t region)
+{
+	return &index->shards[(region * 0x9E3779B97F4A7C15ULL) >> (64 - SHARD_BITS)];
+}
+
+//Mark the region as holding nodes. Called with its shard's lock held
+static void region_mark(shard_index *index, uintptr_t region)
+{
+	uint64_t bit = 1ULL << (region % 64);
+
+	if (region >= SHARD_REGIONS || (__atomic_load_n(&index->occupied[region / 64], __ATOMIC_RELAXED) & bit) != 0)
+	{
+		return;
+	}
+
+	__atomic_fetch_or(&index->summary[region / 4096], 1ULL << (region / 64 % 64), __ATOMIC_RELAXED);
+	__atomic_fetch_or(&index->occupied[region / 64], bit, __ATOMIC_RELAXED);
+}
+
+//Clear the region's bit if it no longer holds any node. Erasing leaves
+//the bit set, so this runs when a lookup finds a region empty
+//Summary bits stay set, costing at most a load of an empty word
+static void region_sweep(shard_index *index, uintptr_t region)
+{
+	shard *s = shard_of(index, region);
+	node *last;
+
+	pthread_mutex_lock(&s->lock);
+	last = tree_find_GLT(s->tree, (void *)((region + 1) << SHARD_REGION_SHIFT));
+	if (last == NULL || region_of(last->addr) != region)
+	{
+		__atomic_fetch_and(&index->occupied[region / 64], ~(1ULL << (region % 64)), __ATOMIC_RELAXED);
+	}
+	pthread_mutex_unlock(&s->lock);
+}
+
+//Set below to the highest occupied region before region
+//Return 0 if there is one, -1 otherwise
+static int region_below(shard_index *index, uintptr_t region, uintptr_t *below)
+{
+	uintptr_t word = region / 64;
+	uint64_t bits = __atomic_load_n(&index->occupied[word], __ATOMIC_RELAXED) & ((1ULL << (region % 64)) - 1);
+
+	while (bits == 0)
+	{
+		uintptr_t group = word / 64;
+		uint64_t words = __atomic_load_n(&index->summary[group], __ATOMIC_RELAXED) & ((1ULL << (word % 64)) - 1);
+
+		while (words == 0)
+		{
+			if (group == 0)
+			{
+				return -1;
+			}
+			words = __atomic_load_n(&index->summary[--group], __ATOMIC_RELAXED);
+		}
+
+		word = group * 64 + 63 - __builtin_clzll(words);
+		bits = __atomic_load_n(&index->occupied[word], __ATOMIC_RELAXED);
+	}
+
+	*below = word * 64 + 63 - __builtin_clzll(bits);
+
+	return 0;
+}
+
+//Take the shard's lock for a change to its tree
+static void write_begin(shard *s)
+{
+	pthread_mutex_lock(&s->lock);
+	__atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+//Publish the change and release the lock
+static void write_end(shard *s)
+{
+	__atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&s->lock);
+}
+
+//Create a sharded index whose shards use the backend named by the
+//MALLOC537_INDEX environment variable, or the red-black tree if it is
+//unset or unknown
+shard_index *shard_create()
+{
+	const char *name = getenv(TREE_BACKEND_ENV);
+
+	if (name != NULL && tree_backend(name) == NULL)
+	{
+		fprintf(stderr, "Warning: Unknown index backend %s, using %s\n", name, TREE_DEFAULT_BACKEND);
+		name = NULL;
+	}
+
+	return shard_create_backend(name == NULL ? TREE_DEFAULT_BACKEND : name);
+}
+
+//Create a sharded index whose shards use the built in backend with the
+//given name. Return NULL if there is no such backend or out of memory
+shard_index *shard_create_backend(const char *name)
+{
+	const tree_ops *ops = tree_backend(name);
+	shard_index *index;
+
+	if (ops == NULL)
+	{
+		return NULL;
+	}
+
+	index = mmap(NULL, sizeof(shard_index), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (index == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	for (int i = 0; i < SHARD_COUNT; i++)
+	{
+		pthread_mutex_init(&index->shards[i].lock, NULL);
+		index->shards[i].seq = 0;
+		index->shards[i].tree = tree_create_ops(ops);
+	}
+	index->count = 0;
+
+	return index;
+}
+
+//Return the name of the backend used by the index's shards
+const char *shard_backend_name(shard_index *index)
+{
+	return tree_backend_name(index->shards[0].tree);
+}
+
+//Insert a node for the block [addr, addr + length) into its shard
+//Return the node stored in the shard's tree, or NULL if it failed
+node *shard_insert(shard_index *index, void *addr, size_t length)
+{
+	shard *s = shard_of(index, region_of(addr));
+	node *ret;
+
+	write_begin(s);
+	ret = node_insert(s->tree, addr, length);
+	if (ret != NULL)
+	{
+		region_mark(index, region_of(addr));
+	}
+	write_end(s);
+
+	if (ret != NULL)
+	{
+		__atomic_fetch_add(&index->count, 1, __ATOMIC_RELAXED);
+	}
+
+	return ret;
+}
+
+//Insert a copy of each of n nodes sorted by address, one node_insert_batch
+//per run of nodes in the same region
+//out[i] is set to the stored copy of items[i], or NULL if it failed
+//Return 0 if every node was inserted, -1 otherwise
+int shard_insert_batch(shard_index *index, const node *items, size_t n, node **out)
+{
+	int ret = 0;
+
+	memset(out, 0, n * sizeof(node *));
+
+	for (size_t i = 0, j; i < n; i = j)
+	{
+		uintptr_t region = region_of(items[i].addr);
+		shard *s = shard_of(index, region);
+		size_t before;
+
+		for (j = i + 1; j < n && region_of(items[j].addr) == region; j++)
+		{
+		}
+
+		write_begin(s);
+		before = tree_size(s->tree);
+		if (node_insert_batch(s->tree, items + i, j - i, out + i) != 0)
+		{
+			ret = -1;
+		}
+		if (tree_size(s->tree) != before)
+		{
+			region_mark(index, region);
+		}
+		__atomic_fetch_add(&index->count, tree_size(s->tree) - before, __ATOMIC_RELAXED);
+		write_end(s);
+	}
+
+	return ret;
+}
+
+//Erase the node at addr from its shard
+//Return 0 on success, -1 if there is no node at addr, as when another
+//thread erased it first
+int shard_erase(shard_index *index, void *addr)
+{
+	shard *s = shard_of(index, region_of(addr));
+	int ret = -1;
+
+	write_begin(s);
+	if (tree_find(s->tree, addr) != NULL)
+	{
+		ret = tree_erase(s->tree, addr);
+	}
+	write_end(s);
+
+	if (ret == 0)
+	{
+		__atomic_fetch_sub(&index->count, 1, __ATOMIC_RELAXED);
+	}
+
+	return ret;
+}
+
+//Erase the nodes at n addresses sorted in ascending order, one
+//tree_erase_batch per run of addresses in the same region
+//Return 0 if every node was erased, -1 otherwise
+int shard_erase_batch(shard_index *index, void **addrs, size_t n)
+{
+	int ret = 0;
+
+	for (size_t i = 0, j; i < n; i = j)
+	{
+		uintptr_t region = region_of(addrs[i]);
+		shard *s = shard_of(index, region);
+		size_t before;
+
+		for (j = i + 1; j < n && region_of(addrs[j]) == region; j++)
+		{
+		}
+
+		write_begin(s);
+		before = tree_size(s->tree);
+		if (tree_erase_batch(s->tree, addrs + i, j - i) != 0)
+		{
+			ret = -1;
+		}
+		__atomic_fetch_sub(&index->count, before - tree_size(s->tree), __ATOMIC_RELAXED);
+		write_end(s);
+	}
+
+	return ret;
+}
+
+//Return the node at addr, or NULL if there is none
+//The lookup runs without the lock, and is retried if a writer changed the
+//shard meanwhile. The caller must be in an epoch read section, which keeps
+//the node from being reclaimed until it leaves
+node *shard_find(shard_index *index, void *addr)
+{
+	shard *s = shard_of(index, region_of(addr));
+	unsigned long seq;
+	node *found;
+
+	for (int tries = 0; tries < SHARD_READ_TRIES; tries++)
+	{
+		seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1)
+		{
+			continue;
+		}
+
+		found = tree_find(s->tree, addr);
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) == seq)
+		{
+			return found;
+		}
+	}
+
+	//Writers kept getting in the way
+	pthread_mutex_lock(&s->lock);
+	found = tree_find(s->tree, addr);
+	pthread_mutex_unlock(&s->lock);
+
+	return found;
+}
+
+//Return the node with the greatest address below addr in one shard, read
+//the same way as shard_find
+static node *shard_read_GLT(shard *s, void *addr)
+{
+	unsigned long seq;
+	node *found;
+
+	for (int tries = 0; tries < SHARD_READ_TRIES; tries++)
+	{
+		seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1)
+		{
+			continue;
+		}
+
+		found = tree_find_GLT(s->tree, addr);
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) == seq)
+		{
+			return found;
+		}
+	}
+
+	//Writers kept getting in the way
+	pthread_mutex_lock(&s->lock);
+	found = tree_find_GLT(s->tree, addr);
+	pthread_mutex_unlock(&s->lock);
+
+	return found;
+}
+
+//Return the node with the greatest address below addr, or NULL if there
+//is none. Every node starting in addr's region is in addr's shard, so a
+//miss there moves to the nearest earlier occupied region and its shard
+//Like shard_find, this runs without the locks inside an epoch read section
+node *shard_find_GLT(shard_index *index, void *addr)
+{
+	uintptr_t region = region_of(addr);
+	node *found, *best = NULL;
+
+	if (region >= SHARD_REGIONS)
+	{
+		//Past the bitmap, so any shard may hold the answer
+		for (int i = 0; i < SHARD_COUNT; i++)
+		{
+			found = shard_read_GLT(&index->shards[i], addr);
+			if (found != NULL && (best == NULL || found->addr > best->addr))
+			{
+				best = found;
+			}
+		}
+
+		return best;
+	}
+
+	for (;;)
+	{
+		found = shard_read_GLT(shard_of(index, region), addr);
+		if (found != NULL && region_of(found->addr) >= region)
+		{
+			return found;
+		}
+
+		if (region != region_of(addr))
+		{
+			region_sweep(index, region);
+		}
+
+		if (region_below(index, region, &region) != 0)
+		{
+			return NULL;
+		}
+	}
+}
+
+//Copy the visited node into the batch, stopping at the end of the
+//batch's region or once the batch is full
+static int batch_visit(node *visited, void *arg)
+{
+	walk_batch *batch = arg;
+
+	if (region_of(visited->addr) != batch->region)
+	{
+		return 1;
+	}
+
+	batch->nodes[batch->n++] = *visited;
+
+	return batch->n == SHARD_WALK_BATCH;
+}
+
+//Record the first node visited and stop
+static int first_visit(node *visited, void *arg)
+{
+	*(void **)arg = visited->addr;
+
+	return 1;
+}
+
+//Set first to the lowest node address that is not below from in any shard
+//Return 0 if there is one, -1 if every node starts below from
+static int first_from(shard_index *index, void *from, void **first)
+{
+	int ret = -1;
+
+	for (int i = 0; i < SHARD_COUNT; i++)
+	{
+		void *addr = NULL;
+
+		pthread_mutex_lock(&index->shards[i].lock);
+		tree_walk(index->shards[i].tree, from, first_visit, &addr);
+		pthread_mutex_unlock(&index->shards[i].lock);
+
+		if (addr != NULL && (ret != 0 || addr < *first))
+		{
+			*first = addr;
+			ret = 0;
+		}
+	}
+
+	return ret;
+}
+
+//Visit the nodes in address order, starting at the first node whose
+//address is not less than from, until visit returns nonzero
+//Regions are walked one at a time in their shard, in batches of copies,
+//so visit gets a copy of each node and may call back into the index
+void shard_walk(shard_index *index, void *from, tree_visit_f visit, void *arg)
+{
+	walk_batch batch;
+	void *cursor = from;
+
+	while (first_from(index, cursor, &cursor) == 0)
+	{
+		shard *s;
+
+		batch.region = region_of(cursor);
+		s = shard_of(index, batch.region);
+
+		do
+		{
+			batch.n = 0;
+
+			pthread_mutex_lock(&s->lock);
+			tree_walk(s->tree, cursor, batch_visit, &batch);
+			pthread_mutex_unlock(&s->lock);
+
+			for (size_t i = 0; i < batch.n; i++)
+			{
+				if (visit(&batch.nodes[i], arg))
+				{
+					return;
+				}
+			}
+
+			if (batch.n > 0)
+			{
+				cursor = (char *)batch.nodes[batch.n - 1].addr + 1;
+			}
+		} while (batch.n == SHARD_WALK_BATCH);
+
+		//The region is done, carry on from wherever the next node is
+		cursor = (void *)((batch.region + 1) << SHARD_REGION_SHIFT);
+	}
+}
+
+//shard_find_GLT and shard_walk in the form tree_find_overlapping_in takes
+static node *index_glt(void *set, void *addr)
+{
+	return shard_find_GLT(set, addr);
+}
+
+static void index_walk(void *set, void *from, tree_visit_f visit, void *arg)
+{
+	shard_walk(set, from, visit, arg);
+}
+
+//Visit, in address order, every node whose block intersects the window
+//[lo, hi), until visit returns nonzero
+void shard_find_overlapping(shard_index *index, void *lo, void *hi, tree_visit_f visit, void *arg)
+{
+	tree_find_overlapping_in(index, index_glt, index_walk, lo, hi, visit, arg);
+}
+
+//Return the number of nodes in the index
+size_t shard_size(shard_index *index)
+{
+	return __atomic_load_n(&index->count, __ATOMIC_RELAXED);
+}
+
+//Return the bytes mapped for the index itself. The shards' trees take
+//their nodes from pools
+size_t shard_mapped_bytes(shard_index *index)
+{
+	(void)index;
+	return sizeof(shard_index);
+}
@@ -0,0 +1,57 @@
+#ifndef SHARD_INDEX_H
+#define SHARD_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "range_tree.h"
+
+//Addresses are split into regions of 2^SHARD_REGION_SHIFT bytes, the size
+//of an arena and of a libc thread heap, so each thread mostly works in
+//shards of its own
+#define SHARD_REGION_SHIFT 26
+
+//Number of shards, a power of two. Every region hashes to one shard
+#define SHARD_BITS 6
+#define SHARD_COUNT (1 << SHARD_BITS)
+
+//Nodes copied out of the shards per lock hold during a walk
+#define SHARD_WALK_BATCH 64
+
+//Address bits covered by the region occupancy bitmap. Lookups above it
+//fall back to probing every shard
+#define SHARD_ADDRESS_BITS 48
+#define SHARD_REGIONS ((uintptr_t)1 << (SHARD_ADDRESS_BITS - SHARD_REGION_SHIFT))
+
+//Lock free attempts shard_find makes before it takes the shard's lock
+#define SHARD_READ_TRIES 4
+
+typedef struct shard_index shard_index;
+
+//Shard Index Functions
+shard_index *shard_create();
+
+shard_index *shard_create_backend(const char *name);
+
+const char *shard_backend_name(shard_index *index);
+
+node *shard_insert(shard_index *index, void *addr, size_t length);
+
+int shard_insert_batch(shard_index *index, const node *items, size_t n, node **out);
+
+int shard_erase(shard_index *index, void *addr);
+
+int shard_erase_batch(shard_index *index, void **addrs, size_t n);
+
+node *shard_find(shard_index *index, void *addr);
+
+node *shard_find_GLT(shard_index *index, void *addr);
+
+void shard_walk(shard_index *index, void *from, tree_visit_f visit, void *arg);
+
+void shard_find_overlapping(shard_index *index, void *lo, void *hi, tree_visit_f visit, void *arg);
+
+size_t shard_size(shard_index *index);
+
+size_t shard_mapped_bytes(shard_index *index);
+
+#endif
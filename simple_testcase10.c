@@ -0,0 +1,97 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "537malloc.h"
+
+#define N 20000
+#define BUCKETS 512
+
+//Requested sizes, the odd ones through malloc537 and the even ones
+//through malloc537_batch
+static size_t sizes[N];
+
+//Return nonzero, printing why, unless the histogram's pct'th percentile
+//bounds the exact one from above, to within a quarter
+static int check_percentile(double pct) {
+	size_t exact = sizes[(size_t)ceil(pct / 100 * N) - 1];
+	size_t reported = malloc537_size_percentile(pct);
+
+	if(reported < exact || reported > exact + exact / 4) {
+		printf("p%g: reported %zu, exact %zu\n", pct, reported, exact);
+		return 1;
+	}
+
+	return 0;
+}
+
+//Counts requests of sizes 1 to N bytes and checks the histogram's ranges
+//and counts, and its percentiles against the exact ones
+int main() {
+	static size_t counts[BUCKETS], lower[BUCKETS];
+	static size_t batch_sizes[N / 2];
+	static void *batch[N / 2];
+	size_t buckets, total = 0, below = 0;
+	void *ptr;
+	size_t i;
+
+	for(i = 0; i < N; i++) {
+		sizes[i] = i + 1;
+		if(i % 2 == 0) {
+			free537(malloc537(sizes[i]));
+		} else {
+			batch_sizes[i / 2] = sizes[i];
+		}
+	}
+	malloc537_batch(batch_sizes, N / 2, batch);
+	free537_batch(batch, N / 2);
+
+	buckets = malloc537_size_histogram(counts, lower, BUCKETS);
+	if(buckets > BUCKETS) {
+		printf("%zu ranges, more than the test holds\n", buckets);
+		return 1;
+	}
+
+	//Ranges start in order, and each counts the sizes from its start to
+	//the next one's
+	for(i = 0; i < buckets; i++) {
+		size_t end = (i + 1 < buckets) ? lower[i + 1] : (size_t)-1;
+		size_t want = 0;
+
+		if(i > 0 && lower[i] <= lower[i - 1]) {
+			printf("Range %zu starts at %zu, before range %zu\n", i, lower[i], i - 1);
+			return 1;
+		}
+
+		if(lower[i] <= N) {
+			want = (end > N + 1 ? N + 1 : end) - (lower[i] < 1 ? 1 : lower[i]);
+		}
+		if(counts[i] != want) {
+			printf("Range from %zu counted %zu requests, expected %zu\n", lower[i], counts[i], want);
+			return 1;
+		}
+		total += counts[i];
+	}
+	if(total != N) {
+		printf("%zu requests counted, expected %d\n", total, N);
+		return 1;
+	}
+
+	if(check_percentile(50) || check_percentile(90) || check_percentile(99) || check_percentile(99.9)) {
+		return 1;
+	}
+
+	//A resize counts as a request for its new size
+	for(i = 0; i < buckets && lower[i] <= 3 * N; i++) {
+		below = i;
+	}
+	ptr = realloc537(malloc537(3 * N), 3 * N);
+	malloc537_size_histogram(counts, NULL, BUCKETS);
+	if(counts[below] != 2) {
+		printf("Range from %zu counted %zu requests, expected 2\n", lower[below], counts[below]);
+		return 1;
+	}
+	free537(ptr);
+
+	printf("If this prints, you get points!\n");
+	return 0;
+}
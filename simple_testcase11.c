@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "537malloc.h"
+
+#define COUNT 200
+
+static char *ptr[COUNT];
+static size_t sizes[COUNT];
+
+//What a query found
+typedef struct found {
+	size_t count;
+	char *last;
+	int unordered;
+} found;
+
+static int record(void *addr, size_t length, void *arg) {
+	found *seen = arg;
+
+	(void)length;
+	if(seen->last != NULL && (char *)addr <= seen->last) {
+		seen->unordered = 1;
+	}
+	seen->last = addr;
+	seen->count++;
+
+	return 0;
+}
+
+//Check malloc537_overlapping reports exactly the blocks intersecting
+//[lo, hi), in address order
+static int check_window(char *lo, char *hi) {
+	found seen = {0, NULL, 0};
+	size_t expected = 0;
+	int i;
+
+	for(i = 0; i < COUNT; i++) {
+		if(ptr[i] != NULL && ptr[i] < hi && ptr[i] + sizes[i] > lo) {
+			expected++;
+		}
+	}
+
+	malloc537_overlapping(lo, hi, record, &seen);
+
+	if(seen.count != expected || seen.unordered) {
+		printf("Window [%p, %p): found %zu blocks, expected %zu\n", (void *)lo, (void *)hi, seen.count, expected);
+		return 1;
+	}
+
+	return 0;
+}
+
+int main() {
+	int i;
+
+	for(i = 0; i < COUNT; i++) {
+		sizes[i] = 16 + (i * 53) % 400;
+		ptr[i] = malloc537(sizes[i]);
+	}
+
+	//Free a few so windows also cover holes
+	for(i = 0; i < COUNT; i += 7) {
+		free537(ptr[i]);
+		ptr[i] = NULL;
+	}
+
+	for(i = 1; i + 20 < COUNT; i += 3) {
+		if(ptr[i] == NULL || ptr[i + 20] == NULL) {
+			continue;
+		}
+
+		//From inside one block, from its last byte, from one past its end
+		if(check_window(ptr[i] + sizes[i] / 2, ptr[i + 20]) ||
+		   check_window(ptr[i] + sizes[i] - 1, ptr[i] + sizes[i]) ||
+		   check_window(ptr[i] + sizes[i], ptr[i] + sizes[i] + 1) ||
+		   check_window(ptr[i + 20], ptr[i])) {
+			return 1;
+		}
+	}
+
+	for(i = 0; i < COUNT; i++) {
+		if(ptr[i] != NULL) {
+			free537(ptr[i]);
+		}
+	}
+
+	printf("If this prints, you get points!\n");
+
+	return 0;
+}
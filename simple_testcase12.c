@@ -0,0 +1,48 @@
+#include <stdio.h>
+#include <string.h>
+#include "537malloc.h"
+
+#define NEIGHBOURS 64
+
+//Frees a batch of slab objects of different sizes in arena mode with the
+//fill mode on, checking that each is poisoned over its own length only and
+//the blocks around it keep their contents
+int main() {
+	size_t sizes[2] = {16, 1000};
+	void *batch[2];
+	char *near[NEIGHBOURS];
+	int i, j;
+
+	if(malloc537_allocator("arena") != 0) {
+		printf("Could not choose the arena allocator\n");
+		return 1;
+	}
+	malloc537_fill(1);
+
+	//Blocks of both sizes placed after the batch's blocks, whose slots the
+	//later batches reuse
+	malloc537_batch(sizes, 2, batch);
+	for(i = 0; i < NEIGHBOURS; i++) {
+		near[i] = malloc537(sizes[i % 2]);
+		memset(near[i], 'a' + i % 26, sizes[i % 2]);
+	}
+	free537_batch(batch, 2);
+
+	for(i = 0; i < 100; i++) {
+		malloc537_batch(sizes, 2, batch);
+		free537_batch(batch, 2);
+	}
+
+	for(i = 0; i < NEIGHBOURS; i++) {
+		for(j = 0; j < (int)sizes[i % 2]; j++) {
+			if(near[i][j] != 'a' + i % 26) {
+				printf("Block %d of %zu bytes overwritten at byte %d\n", i, sizes[i % 2], j);
+				return 1;
+			}
+		}
+		free537(near[i]);
+	}
+
+	printf("If this prints, you get points!\n");
+	return 0;
+}
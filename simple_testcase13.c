@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include "537malloc.h"
+
+#define N 200
+
+//Return nonzero, printing when, if the live totals are not bytes and blocks
+static int check_live(const char *when, size_t bytes, size_t blocks) {
+	struct malloc537_stats stats;
+
+	malloc537_stats(&stats);
+	if(stats.live_bytes != bytes || stats.live_blocks != blocks) {
+		printf("%s: %zu bytes in %zu blocks live, expected %zu in %zu\n", when,
+			stats.live_bytes, stats.live_blocks, bytes, blocks);
+		return 1;
+	}
+
+	return 0;
+}
+
+//Allocates and frees batches of mixed sizes in arena mode, where small
+//blocks live in slabs, and checks the live totals after each step and the
+//peak, which must be exact in a program with one thread
+int main() {
+	struct malloc537_stats stats;
+	size_t sizes[N], total = 0;
+	void *ptrs[N];
+	int round, i;
+
+	if(malloc537_allocator("arena") != 0) {
+		printf("Could not choose the arena allocator\n");
+		return 1;
+	}
+
+	//A spike freed before any other block is allocated still sets the peak
+	free537(malloc537(40000));
+	malloc537_stats(&stats);
+	if(stats.peak_bytes != 40000) {
+		printf("Peak of %zu bytes after a 40000 byte spike\n", stats.peak_bytes);
+		return 1;
+	}
+
+	for(i = 0; i < N; i++) {
+		sizes[i] = (i % 4 == 3) ? 5000 + (size_t)i : 16 + (size_t)i * 5;
+		total += sizes[i];
+	}
+
+	for(round = 0; round < 10; round++) {
+		malloc537_batch(sizes, N, ptrs);
+		if(check_live("After malloc537_batch", total, N)) {
+			return 1;
+		}
+
+		free537_batch(ptrs, N);
+		if(check_live("After free537_batch", 0, 0)) {
+			return 1;
+		}
+	}
+
+	malloc537_stats(&stats);
+	if(stats.peak_bytes != total) {
+		printf("Peak of %zu bytes, expected %zu\n", stats.peak_bytes, total);
+		return 1;
+	}
+
+	printf("If this prints, you get points!\n");
+	return 0;
+}
@@ -0,0 +1,62 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "537malloc.h"
+
+#define BATCHES 4000
+#define BATCH 100
+#define SIZE 64
+
+//Allocates BATCHES batches of BATCH blocks of SIZE bytes at a 512KB
+//sampling interval and never frees them, then checks that the leak
+//report's estimate of the bytes leaked is near the true amount. Batches
+//are sampled as a whole, so their blocks must be weighted as a batch
+int main() {
+	size_t sizes[BATCH], bytes, blocks, estimate = 0;
+	size_t leaked = (size_t)BATCHES * BATCH * SIZE;
+	void *ptrs[BATCH];
+	char line[256];
+	FILE *report;
+	int i, saved;
+
+	//Slab objects of the arena allocator are not attributed to sites
+	if(malloc537_allocator("libc") != 0) {
+		printf("Could not choose the libc allocator\n");
+		return 1;
+	}
+	malloc537_sample_interval(512 * 1024);
+	for(i = 0; i < BATCH; i++) {
+		sizes[i] = SIZE;
+	}
+	for(i = 0; i < BATCHES; i++) {
+		malloc537_batch(sizes, BATCH, ptrs);
+	}
+
+	//Capture the report, which goes to stderr
+	report = tmpfile();
+	saved = dup(2);
+	if(report == NULL || saved < 0 || dup2(fileno(report), 2) < 0) {
+		printf("Could not capture the leak report\n");
+		return 1;
+	}
+	malloc537_leak_report(100);
+	fflush(stderr);
+	dup2(saved, 2);
+
+	rewind(report);
+	while(fgets(line, sizeof(line), report) != NULL) {
+		//Site lines only, not the totals of blocks that were not sampled
+		if(strstr(line, "allocated at") != NULL && sscanf(line, "%zu bytes in %zu blocks", &bytes, &blocks) == 2) {
+			estimate += bytes;
+		}
+	}
+
+	if(estimate < leaked / 2 || estimate > leaked * 2) {
+		printf("Leak report estimated %zu bytes, %zu were leaked\n", estimate, leaked);
+		return 1;
+	}
+
+	printf("If this prints, you get points!\n");
+	return 0;
+}
@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "537malloc.h"
+
+#define COUNT 5000
+
+//Runs the B+ tree index backend through enough blocks to split and merge
+//its nodes, checking lookups against the blocks still allocated
+int main() {
+	static char *ptr[COUNT];
+	static const void *check[COUNT];
+	static size_t sizes[COUNT];
+	static size_t ones[COUNT];
+	memcheck537_status *status;
+	int i;
+
+	setenv("MALLOC537_INDEX", "bptree", 1);
+
+	for(i = 0; i < COUNT; i++) {
+		sizes[i] = 1 + (i * 37) % 300;
+		ptr[i] = malloc537(sizes[i]);
+		ones[i] = 1;
+	}
+
+	//The last byte of every block is inside it, one past the end is not
+	for(i = 0; i < COUNT; i++) {
+		check[i] = ptr[i] + sizes[i] - 1;
+	}
+	status = memcheck537_many(check, ones, COUNT);
+	for(i = 0; i < COUNT; i++) {
+		if(status[i] != MEMCHECK537_OK) {
+			printf("Last byte of %p not found\n", ptr[i]);
+			return 1;
+		}
+	}
+	free(status);
+
+	//Free every other block, the rest must still be found
+	for(i = 0; i < COUNT; i += 2) {
+		free537(ptr[i]);
+	}
+	for(i = 1; i < COUNT; i += 2) {
+		memcheck537(ptr[i], sizes[i]);
+	}
+
+	for(i = 0; i < COUNT; i += 2) {
+		check[i / 2] = ptr[i];
+	}
+	status = memcheck537_many(check, ones, COUNT / 2);
+	for(i = 0; i < COUNT / 2; i++) {
+		if(status[i] == MEMCHECK537_OK) {
+			printf("Freed block %p still found\n", check[i]);
+			return 1;
+		}
+	}
+	free(status);
+
+	for(i = 1; i < COUNT; i += 2) {
+		free537(ptr[i]);
+	}
+
+	printf("If this prints, you get points!\n");
+
+	return 0;
+}
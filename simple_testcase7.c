@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "537malloc.h"
+
+#define COUNT 3000
+
+//Return the memcheck537_many status of the size bytes at ptr
+static memcheck537_status status_of(void *ptr, size_t size) {
+	const void *ptrs[1] = {ptr};
+	memcheck537_status *status = memcheck537_many(ptrs, &size, 1);
+	memcheck537_status ret = status[0];
+
+	free(status);
+	return ret;
+}
+
+//Exact lookups must follow blocks through frees, address reuse and resizes,
+//with enough blocks live to make the hash index grow
+int main() {
+	static char *ptr[COUNT];
+	int i;
+
+	for(i = 0; i < COUNT; i++) {
+		ptr[i] = malloc537(64);
+	}
+
+	//A freed address handed out again is found with its new length
+	for(i = 0; i < COUNT; i += 3) {
+		free537(ptr[i]);
+		ptr[i] = malloc537(32);
+		if(status_of(ptr[i], 32) != MEMCHECK537_OK || status_of(ptr[i], 33) != MEMCHECK537_SIZE_OUT_OF_BOUNDS) {
+			printf("Block %p found with a stale length\n", ptr[i]);
+			return 1;
+		}
+	}
+
+	//Resized blocks are found at their new address with their new length
+	for(i = 1; i < COUNT; i += 3) {
+		ptr[i] = realloc537(ptr[i], 16);
+		if(status_of(ptr[i], 16) != MEMCHECK537_OK || status_of(ptr[i], 17) != MEMCHECK537_SIZE_OUT_OF_BOUNDS) {
+			printf("Shrunk block %p found with a stale length\n", ptr[i]);
+			return 1;
+		}
+	}
+	for(i = 2; i < COUNT; i += 3) {
+		ptr[i] = realloc537(ptr[i], 4096);
+		if(status_of(ptr[i], 4096) != MEMCHECK537_OK || status_of(ptr[i], 4097) != MEMCHECK537_SIZE_OUT_OF_BOUNDS) {
+			printf("Grown block %p found with a stale length\n", ptr[i]);
+			return 1;
+		}
+	}
+
+	for(i = 0; i < COUNT; i++) {
+		free537(ptr[i]);
+	}
+
+	printf("If this prints, you get points!\n");
+
+	return 0;
+}
@@ -0,0 +1,75 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "537malloc.h"
+
+#define MB (1024 * 1024)
+
+//Return nonzero if the size bytes at ptr are not one live block
+static int bad_block(char *ptr, size_t size) {
+	const void *ptrs[3] = {ptr, ptr + size - 1, ptr + size / 2};
+	size_t sizes[3] = {size, 1, size - size / 2};
+	memcheck537_status *status = memcheck537_many(ptrs, sizes, 3);
+	int bad = status[0] != MEMCHECK537_OK || status[1] != MEMCHECK537_OK || status[2] != MEMCHECK537_OK;
+
+	free(status);
+	return bad;
+}
+
+//Runs arena blocks of every kind: medium blocks carved from arenas, and
+//large blocks with spans of their own, through writes, lookups and resizes
+//across the size where blocks move between the two
+int main() {
+	size_t sizes[] = {2000, 100000, 15 * MB, 16 * MB + 1, 40 * MB};
+	char *ptr[5];
+	int i;
+
+	if(malloc537_allocator("arena") != 0) {
+		printf("Could not choose the arena allocator\n");
+		return 1;
+	}
+
+	for(i = 0; i < 5; i++) {
+		ptr[i] = malloc537(sizes[i]);
+		memset(ptr[i], i + 1, sizes[i]);
+		if(bad_block(ptr[i], sizes[i])) {
+			printf("Block of %zu bytes at %p not found\n", sizes[i], ptr[i]);
+			return 1;
+		}
+	}
+
+	//Medium to large and back, keeping the contents
+	ptr[1] = realloc537(ptr[1], 20 * MB);
+	if(bad_block(ptr[1], 20 * MB) || ptr[1][99999] != 2) {
+		printf("Block grown into a span lost its contents\n");
+		return 1;
+	}
+	ptr[4] = realloc537(ptr[4], 3000);
+	if(bad_block(ptr[4], 3000) || ptr[4][2999] != 5) {
+		printf("Span shrunk into an arena lost its contents\n");
+		return 1;
+	}
+
+	//A freed span is no longer found
+	free537(ptr[3]);
+	{
+		const void *freed[1] = {ptr[3] + MB};
+		size_t one = 1;
+		memcheck537_status *status = memcheck537_many(freed, &one, 1);
+
+		if(status[0] == MEMCHECK537_OK) {
+			printf("Freed span still found\n");
+			return 1;
+		}
+		free(status);
+	}
+
+	free537(ptr[0]);
+	free537(ptr[1]);
+	free537(ptr[2]);
+	free537(ptr[4]);
+
+	printf("If this prints, you get points!\n");
+
+	return 0;
+}
@@ -0,0 +1,98 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include "537malloc.h"
+
+#define COUNT 1000
+#define ROUNDS 20
+
+static void *blocks[COUNT];
+
+//Free every block, none of which this thread allocated
+static void *free_all(void *arg) {
+	(void)arg;
+	for(int i = 0; i < COUNT; i++) {
+		free537(blocks[i]);
+	}
+	return NULL;
+}
+
+//Allocate the blocks in this thread, then exit
+static void *alloc_all(void *arg) {
+	(void)arg;
+	for(int i = 0; i < COUNT; i++) {
+		blocks[i] = malloc537(48);
+	}
+	return NULL;
+}
+
+static int cmp(const void *p1, const void *p2) {
+	char *a = *(char * const *)p1, *b = *(char * const *)p2;
+	return (a > b) - (a < b);
+}
+
+//Small arena blocks freed by another thread than their owner must stop
+//being found at once, and go back to the owner for reuse
+int main() {
+	static void *first[COUNT];
+	static size_t ones[COUNT];
+	pthread_t tid;
+	memcheck537_status *status;
+	size_t reused = 0;
+	int i, round;
+
+	malloc537_allocator("arena");
+
+	for(i = 0; i < COUNT; i++) {
+		blocks[i] = first[i] = malloc537(48);
+		ones[i] = 1;
+	}
+	qsort(first, COUNT, sizeof(void *), cmp);
+
+	for(round = 0; round < ROUNDS; round++) {
+		pthread_create(&tid, NULL, free_all, NULL);
+		pthread_join(tid, NULL);
+
+		status = memcheck537_many((const void **)blocks, ones, COUNT);
+		for(i = 0; i < COUNT; i++) {
+			if(status[i] == MEMCHECK537_OK) {
+				printf("Block %p freed by another thread still found\n", blocks[i]);
+				return 1;
+			}
+		}
+		free(status);
+
+		for(i = 0; i < COUNT; i++) {
+			blocks[i] = malloc537(48);
+		}
+	}
+
+	//After many rounds the owner is still reusing the first slots
+	for(i = 0; i < COUNT; i++) {
+		if(bsearch(&blocks[i], first, COUNT, sizeof(void *), cmp) != NULL) {
+			reused++;
+		}
+	}
+	if(reused < COUNT * 9 / 10) {
+		printf("Only %zu of %d remotely freed blocks were reused\n", reused, COUNT);
+		return 1;
+	}
+	free_all(NULL);
+
+	//Blocks of a thread that exited, freed here, are found by no one
+	pthread_create(&tid, NULL, alloc_all, NULL);
+	pthread_join(tid, NULL);
+	free_all(NULL);
+	status = memcheck537_many((const void **)blocks, ones, COUNT);
+	for(i = 0; i < COUNT; i++) {
+		if(status[i] == MEMCHECK537_OK) {
+			printf("Block %p of an exited thread still found\n", blocks[i]);
+			return 1;
+		}
+	}
+	free(status);
+
+	printf("If this prints, you get points!\n");
+
+	return 0;
+}
@@ -0,0 +1,207 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "pool.h"
+#include "site_table.h"
+
+//Table of allocation call sites keyed by stack id, using open
+//addressing with linear probing. Sites are never removed, so a slot once
+//filled keeps its site: lookups probe without locking and only adding a
+//site takes the lock. A full table is replaced by one twice its size, and
+//the old table is left mapped for readers still probing it; together the
+//old tables are smaller than the current one
+
+//A slot array with its mask, published as one pointer
+typedef struct site_slots
+{
+	size_t mask;
+	site *slots[];
+
+} site_slots;
+
+static site_slots *table;
+static size_t count;
+static size_t mapped_bytes;
+static pool sites = POOL_INITIALIZER(sizeof(site));
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+//Home slot of a stack id. Ids are handed out in order, Fibonacci hashing
+//spreads them over the table
+static size_t home_of(size_t mask, uint32_t stack)
+{
+	return (size_t)(((uint64_t)stack * 0x9E3779B97F4A7C15ULL) >> 32) & mask;
+}
+
+//Return the site for the stack in the slot array, or NULL if it has none
+static site *probe(site_slots *slots, uint32_t stack)
+{
+	for (size_t i = home_of(slots->mask, stack);; i = (i + 1) & slots->mask)
+	{
+		site *entry = __atomic_load_n(&slots->slots[i], __ATOMIC_ACQUIRE);
+
+		if (entry == NULL || entry->stack == stack)
+		{
+			return entry;
+		}
+	}
+}
+
+//Publish a slot array with the given number of slots holding every site
+//Must be called with the lock held. Return 0 on success, -1 otherwise
+static int grow(size_t slot_count)
+{
+	size_t bytes = sizeof(site_slots) + slot_count * sizeof(site *);
+	site_slots *old = table;
+	site_slots *slots = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (slots == MAP_FAILED)
+	{
+		return -1;
+	}
+
+	slots->mask = slot_count - 1;
+	__atomic_fetch_add(&mapped_bytes, bytes, __ATOMIC_RELAXED);
+
+	for (size_t i = 0; old != NULL && i <= old->mask; i++)
+	{
+		size_t j;
+
+		if (old->slots[i] == NULL)
+		{
+			continue;
+		}
+
+		for (j = home_of(slots->mask, old->slots[i]->stack); slots->slots[j] != NULL; j = (j + 1) & slots->mask)
+		{
+		}
+		slots->slots[j] = old->slots[i];
+	}
+
+	__atomic_store_n(&table, slots, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+//Add a site for the stack unless another thread added it first
+//Must be called with the lock held. Return the site, or NULL if out of memory
+static site *add(uint32_t stack)
+{
+	site *entry;
+	size_t i;
+
+	if (table != NULL && (entry = probe(table, stack)) != NULL)
+	{
+		return entry;
+	}
+
+	//Keep the table at most half full so probes stay short
+	if (table == NULL || (count + 1) * 2 > table->mask + 1)
+	{
+		if (grow(table == NULL ? SITE_TABLE_MIN_SLOTS : (table->mask + 1) * 2) != 0)
+		{
+			return NULL;
+		}
+	}
+
+	entry = pool_alloc(&sites);
+	if (entry == NULL)
+	{
+		return NULL;
+	}
+
+	entry->stack = stack;
+	entry->allocated_bytes = 0;
+	entry->num_allocations = 0;
+	entry->live_bytes = 0;
+	entry->live_blocks = 0;
+	entry->leaked_bytes = 0;
+	entry->leaked_blocks = 0;
+	memset(&entry->sizes, 0, sizeof(size_hist));
+
+	for (i = home_of(table->mask, stack); table->slots[i] != NULL; i = (i + 1) & table->mask)
+	{
+	}
+
+	//The site is filled in before readers can find it
+	__atomic_store_n(&table->slots[i], entry, __ATOMIC_RELEASE);
+	__atomic_store_n(&count, count + 1, __ATOMIC_RELAXED);
+
+	return entry;
+}
+
+//Return the site for the stack with the given depot id, adding it the
+//first time. Return NULL if out of memory
+site *site_get(uint32_t stack)
+{
+	site_slots *slots = __atomic_load_n(&table, __ATOMIC_ACQUIRE);
+	site *entry = (slots == NULL) ? NULL : probe(slots, stack);
+
+	if (entry != NULL)
+	{
+		return entry;
+	}
+
+	pthread_mutex_lock(&lock);
+	entry = add(stack);
+	pthread_mutex_unlock(&lock);
+
+	return entry;
+}
+
+//Return the number of sites
+size_t site_count()
+{
+	return __atomic_load_n(&count, __ATOMIC_RELAXED);
+}
+
+//Return the bytes mapped for slot arrays, old ones included. Sites
+//themselves come from a pool
+size_t site_mapped_bytes()
+{
+	return __atomic_load_n(&mapped_bytes, __ATOMIC_RELAXED);
+}
+
+//Return an array of every site, setting n to its length, or NULL if out
+//of memory. The array is mapped rather than allocated, so reports do not
+//disturb the heap they describe; its first word, before the sites, holds
+//its size. The caller releases it with site_snapshot_free, the sites stay
+//valid
+site **site_snapshot(size_t *n)
+{
+	size_t bytes;
+	site **out;
+
+	pthread_mutex_lock(&lock);
+
+	*n = 0;
+	bytes = (count + 1) * sizeof(site *);
+	out = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (out == MAP_FAILED)
+	{
+		pthread_mutex_unlock(&lock);
+		return NULL;
+	}
+	out[0] = (site *)bytes;
+	out++;
+
+	for (size_t i = 0; table != NULL && i <= table->mask; i++)
+	{
+		if (table->slots[i] != NULL)
+		{
+			out[(*n)++] = table->slots[i];
+		}
+	}
+
+	pthread_mutex_unlock(&lock);
+
+	return out;
+}
+
+//Release an array returned by site_snapshot
+void site_snapshot_free(site **sites)
+{
+	munmap(sites - 1, (size_t)sites[-1]);
+}
@@ -0,0 +1,39 @@
+#ifndef SITE_TABLE_H
+#define SITE_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "size_hist.h"
+
+//Slots in the first table, a power of two
+#define SITE_TABLE_MIN_SLOTS 256
+
+//Allocations made from one call site, named by the id of its stack in
+//the stack depot, counted with atomic adds. The live counts cover the
+//recorded blocks not yet freed, the leaked counts are filled in by the
+//leak report. sizes counts the sizes the site requested
+typedef struct site
+{
+	uint32_t stack;
+	size_t allocated_bytes;
+	size_t num_allocations;
+	size_t live_bytes;
+	size_t live_blocks;
+	size_t leaked_bytes;
+	size_t leaked_blocks;
+	size_hist sizes;
+
+} site;
+
+//Site Table Functions
+site *site_get(uint32_t stack);
+
+size_t site_count();
+
+size_t site_mapped_bytes();
+
+site **site_snapshot(size_t *n);
+
+void site_snapshot_free(site **sites);
+
+#endif
@@ -0,0 +1,114 @@
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "size_hist.h"
+
+//Histograms of requested sizes. A size's bucket is found from its highest
+//set bit and the SIZE_HIST_SUB_BITS bits below it, so counting a request
+//is one atomic add and the relative error of a bucket is bounded
+
+//Every request made to the allocator
+static size_hist all;
+
+//Return the bucket counting size
+int size_hist_bucket(size_t size)
+{
+	int top;
+
+	if (size < (2 << SIZE_HIST_SUB_BITS))
+	{
+		return (int)size;
+	}
+
+	top = 63 - __builtin_clzll((unsigned long long)size);
+
+	return ((top - SIZE_HIST_SUB_BITS + 1) << SIZE_HIST_SUB_BITS) + (int)((size >> (top - SIZE_HIST_SUB_BITS)) & (SIZE_HIST_SUB - 1));
+}
+
+//Return the smallest size counted in bucket
+size_t size_hist_lower(int bucket)
+{
+	int top;
+
+	if (bucket < (2 << SIZE_HIST_SUB_BITS))
+	{
+		return (size_t)bucket;
+	}
+
+	top = (bucket >> SIZE_HIST_SUB_BITS) + SIZE_HIST_SUB_BITS - 1;
+
+	return (size_t)(SIZE_HIST_SUB + (bucket & (SIZE_HIST_SUB - 1))) << (top - SIZE_HIST_SUB_BITS);
+}
+
+//Return the largest size counted in bucket
+size_t size_hist_upper(int bucket)
+{
+	return (bucket + 1 == SIZE_HIST_BUCKETS) ? SIZE_MAX : size_hist_lower(bucket + 1) - 1;
+}
+
+//Count count requests for size bytes
+void size_hist_add(size_hist *hist, size_t size, size_t count)
+{
+	__atomic_fetch_add(&hist->counts[size_hist_bucket(size)], count, __ATOMIC_RELAXED);
+}
+
+//Return the histogram of every request
+size_hist *size_hist_all()
+{
+	return &all;
+}
+
+//Return the number of requests counted
+size_t size_hist_total(const size_hist *hist)
+{
+	size_t total = 0;
+
+	for (int i = 0; i < SIZE_HIST_BUCKETS; i++)
+	{
+		total += __atomic_load_n(&hist->counts[i], __ATOMIC_RELAXED);
+	}
+
+	return total;
+}
+
+//Return the largest size in the bucket holding the pct'th percentile of
+//the requests, so pct percent of them asked for at most that many bytes
+//Return 0 if no request was counted
+size_t size_hist_percentile(const size_hist *hist, double pct)
+{
+	size_t counts[SIZE_HIST_BUCKETS];
+	size_t total = 0, seen = 0, rank;
+
+	//Work from one copy, so counts changing meanwhile cannot overrun it
+	for (int i = 0; i < SIZE_HIST_BUCKETS; i++)
+	{
+		counts[i] = __atomic_load_n(&hist->counts[i], __ATOMIC_RELAXED);
+		total += counts[i];
+	}
+
+	if (total == 0)
+	{
+		return 0;
+	}
+
+	rank = (size_t)ceil(pct / 100 * total);
+	if (rank < 1)
+	{
+		rank = 1;
+	}
+	if (rank > total)
+	{
+		rank = total;
+	}
+
+	for (int i = 0; i < SIZE_HIST_BUCKETS; i++)
+	{
+		seen += counts[i];
+		if (seen >= rank)
+		{
+			return size_hist_upper(i);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,35 @@
+#ifndef SIZE_HIST_H
+#define SIZE_HIST_H
+
+#include <stddef.h>
+
+//Each power of two is split into 2^SIZE_HIST_SUB_BITS buckets, so a bucket
+//spans at most a quarter of its sizes. Sizes below 2 << SIZE_HIST_SUB_BITS
+//get a bucket each
+#define SIZE_HIST_SUB_BITS 2
+#define SIZE_HIST_SUB (1 << SIZE_HIST_SUB_BITS)
+#define SIZE_HIST_BUCKETS ((64 - SIZE_HIST_SUB_BITS + 1) << SIZE_HIST_SUB_BITS)
+
+//Counts of requested sizes by bucket, updated with atomic adds
+typedef struct size_hist
+{
+	size_t counts[SIZE_HIST_BUCKETS];
+
+} size_hist;
+
+//Size Histogram Functions
+int size_hist_bucket(size_t size);
+
+size_t size_hist_lower(int bucket);
+
+size_t size_hist_upper(int bucket);
+
+void size_hist_add(size_hist *hist, size_t size, size_t count);
+
+size_hist *size_hist_all();
+
+size_t size_hist_total(const size_hist *hist);
+
+size_t size_hist_percentile(const size_hist *hist, double pct);
+
+#endif
@@ -0,0 +1,241 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include "slab.h"
+
+//Bitmaps are read while their owner may be changing them, so every word is
+//loaded atomically
+#define WORD(bits, w) __atomic_load_n(&(bits)[w], __ATOMIC_ACQUIRE)
+
+//Return the highest set bit below limit, or -1 if there is none
+long bitmap_last_below(const uint64_t *bits, size_t limit)
+{
+	size_t w = limit / 64;
+	uint64_t word;
+
+	if (limit % 64 != 0)
+	{
+		word = WORD(bits, w) & ((1ULL << (limit % 64)) - 1);
+		if (word != 0)
+		{
+			return (long)(w * 64 + 63 - __builtin_clzll(word));
+		}
+	}
+
+	while (w-- > 0)
+	{
+		word = WORD(bits, w);
+		if (word != 0)
+		{
+			return (long)(w * 64 + 63 - __builtin_clzll(word));
+		}
+	}
+
+	return -1;
+}
+
+//Return the lowest set bit at or above from and below limit, or -1
+long bitmap_first_from(const uint64_t *bits, size_t from, size_t limit)
+{
+	size_t words = (limit + 63) / 64;
+	size_t w = from / 64;
+	uint64_t word;
+
+	if (from >= limit)
+	{
+		return -1;
+	}
+
+	for (word = WORD(bits, w) & (~0ULL << (from % 64)); word == 0; word = WORD(bits, w))
+	{
+		if (++w >= words)
+		{
+			return -1;
+		}
+	}
+
+	from = w * 64 + __builtin_ctzll(word);
+
+	return from < limit ? (long)from : -1;
+}
+
+//Lay out an empty slab of objects of the given size in the SLAB_BYTES of
+//zero filled memory at mem, which must be aligned to SLAB_BYTES
+//Return the slab
+slab *slab_init(void *mem, size_t size)
+{
+	slab *s = mem;
+	size_t room = SLAB_BYTES - sizeof(slab) - (SLAB_MIN - 1);
+
+	//Each object costs its size plus its entry in lengths
+	s->size = size;
+	s->count = room / (size + sizeof(uint16_t));
+	s->live = 0;
+	s->hint = 0;
+	s->partial = 0;
+	s->next = NULL;
+	s->owner = NULL;
+	s->objects = (char *)(((uintptr_t)&s->lengths[s->count] + SLAB_MIN - 1) & ~(uintptr_t)(SLAB_MIN - 1));
+
+	return s;
+}
+
+//Mark a free object live with the given length
+//Return its slot, or -1 if the slab is full
+long slab_take(slab *s, size_t length)
+{
+	size_t words = (s->count + 63) / 64;
+
+	for (size_t w = s->hint; w < words; w++)
+	{
+		uint64_t free_bits = ~s->bits[w];
+		long slot;
+
+		if (free_bits == 0)
+		{
+			continue;
+		}
+
+		slot = (long)(w * 64 + __builtin_ctzll(free_bits));
+		if (slot >= (long)s->count)
+		{
+			break;
+		}
+
+		//Publish the length before the object becomes visible as live
+		s->lengths[slot] = (uint16_t)length;
+		__atomic_store_n(&s->bits[w], s->bits[w] | (1ULL << (slot % 64)), __ATOMIC_RELEASE);
+		s->live++;
+		s->hint = w;
+
+		return slot;
+	}
+
+	return -1;
+}
+
+//Mark a live object free. Called by the owner only
+void slab_release(slab *s, long slot)
+{
+	uint64_t bit = 1ULL << (slot % 64);
+
+	__atomic_store_n(&s->bits[slot / 64], s->bits[slot / 64] & ~bit, __ATOMIC_RELEASE);
+	__atomic_fetch_and(&s->pending[slot / 64], ~bit, __ATOMIC_RELAXED);
+	s->live--;
+
+	if ((uint32_t)(slot / 64) < s->hint)
+	{
+		s->hint = slot / 64;
+	}
+}
+
+//Mark a live object as freed by a thread other than the owner, to be
+//released once the owner takes it back
+//Return 0 on success, -1 if it was already marked
+int slab_mark_pending(slab *s, long slot)
+{
+	uint64_t bit = 1ULL << (slot % 64);
+
+	return (__atomic_fetch_or(&s->pending[slot / 64], bit, __ATOMIC_ACQ_REL) & bit) ? -1 : 0;
+}
+
+//Return 1 if the object in the given slot is live and not pending
+static int slot_live(slab *s, long slot)
+{
+	uint64_t bit = 1ULL << (slot % 64);
+
+	return (WORD(s->bits, slot / 64) & bit) && !(WORD(s->pending, slot / 64) & bit);
+}
+
+//Return the object in the given slot
+void *slab_object(slab *s, long slot)
+{
+	return s->objects + (size_t)slot * s->size;
+}
+
+//Return the slot of the live object starting at ptr, or -1 if no live
+//object starts there
+long slab_slot(slab *s, void *ptr)
+{
+	size_t offset;
+	long slot;
+
+	if ((char *)ptr < s->objects)
+	{
+		return -1;
+	}
+
+	offset = (char *)ptr - s->objects;
+	slot = (long)(offset / s->size);
+	if (offset % s->size != 0 || slot >= (long)s->count)
+	{
+		return -1;
+	}
+
+	return slot_live(s, slot) ? slot : -1;
+}
+
+//Return the slot of the live object whose class sized slot holds ptr
+//without starting at it, or -1 if there is none
+long slab_slot_inside(slab *s, void *ptr)
+{
+	size_t offset;
+	long slot;
+
+	if ((char *)ptr <= s->objects)
+	{
+		return -1;
+	}
+
+	offset = (char *)ptr - s->objects;
+	slot = (long)(offset / s->size);
+	if (offset % s->size == 0 || slot >= (long)s->count)
+	{
+		return -1;
+	}
+
+	return slot_live(s, slot) ? slot : -1;
+}
+
+//Return the number of slots that start below ptr
+long slab_index(slab *s, void *ptr)
+{
+	size_t index;
+
+	if ((char *)ptr <= s->objects)
+	{
+		return 0;
+	}
+
+	index = ((char *)ptr - s->objects + s->size - 1) / s->size;
+
+	return index > s->count ? (long)s->count : (long)index;
+}
+
+//Return the highest live slot below index, or -1
+long slab_live_below(slab *s, long index)
+{
+	long slot = bitmap_last_below(s->bits, index);
+
+	//Objects freed by other threads are no longer live
+	while (slot >= 0 && !slot_live(s, slot))
+	{
+		slot = bitmap_last_below(s->bits, slot);
+	}
+
+	return slot;
+}
+
+//Return the lowest live slot at or above index, or -1
+long slab_live_from(slab *s, long index)
+{
+	long slot = bitmap_first_from(s->bits, index, s->count);
+
+	while (slot >= 0 && !slot_live(s, slot))
+	{
+		slot = bitmap_first_from(s->bits, slot + 1, s->count);
+	}
+
+	return slot;
+}
@@ -0,0 +1,69 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//Bytes in a slab, a power of two. Slabs are aligned to their size, so the
+//slab holding an object is found by masking its address
+#define SLAB_SHIFT 16
+#define SLAB_BYTES (1UL << SLAB_SHIFT)
+
+//Objects are sized in steps of SLAB_MIN bytes up to SLAB_MAX
+#define SLAB_MIN 16
+#define SLAB_MAX 1024
+#define SLAB_CLASSES (SLAB_MAX / SLAB_MIN)
+
+//Upper bound on the objects in one slab
+#define SLAB_MAX_SLOTS (SLAB_BYTES / SLAB_MIN)
+
+//Return the slab holding the object at ptr
+#define SLAB_OF(ptr) ((slab *)((uintptr_t)(ptr) & ~(SLAB_BYTES - 1)))
+
+//Header at the start of every slab: a bitmap of live objects and the size
+//each live object was allocated with, followed by the objects themselves.
+//Only the owner changes bits; other threads mark objects they free in
+//pending and hand them back to the owner
+typedef struct slab
+{
+	struct slab *next;
+	void *owner;
+	uint32_t size;
+	uint32_t count;
+	uint32_t live;
+	uint32_t hint;
+	int partial;
+	char *objects;
+	uint64_t bits[SLAB_MAX_SLOTS / 64];
+	uint64_t pending[SLAB_MAX_SLOTS / 64];
+	uint16_t lengths[];
+
+} slab;
+
+//Slab Functions
+slab *slab_init(void *mem, size_t size);
+
+long slab_take(slab *s, size_t length);
+
+void slab_release(slab *s, long slot);
+
+int slab_mark_pending(slab *s, long slot);
+
+void *slab_object(slab *s, long slot);
+
+long slab_slot(slab *s, void *ptr);
+
+long slab_slot_inside(slab *s, void *ptr);
+
+long slab_index(slab *s, void *ptr);
+
+long slab_live_below(slab *s, long index);
+
+long slab_live_from(slab *s, long index);
+
+//Bitmap Functions, also used for the arena start bitmaps
+long bitmap_last_below(const uint64_t *bits, size_t limit);
+
+long bitmap_first_from(const uint64_t *bits, size_t from, size_t limit);
+
+#endif
@@ -0,0 +1,270 @@
+#define _GNU_SOURCE
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include "stack_depot.h"
+
+//Stack depot: every distinct call stack is stored once and named by a 32
+//bit id, so a stack can be kept with each site at the cost of an integer
+//Stacks are found through a hash table of chains. Records never change
+//once published, so lookups run without locking and only adding a stack
+//takes the lock. Id 0 is the empty stack
+
+//One stored stack
+typedef struct stack_record
+{
+	struct stack_record *next;
+	uint32_t id;
+	uint32_t hash;
+	uint32_t depth;
+	void *frames[];
+
+} stack_record;
+
+static stack_record *buckets[1 << DEPOT_BUCKET_BITS];
+
+//Records by id, in blocks of DEPOT_BLOCK_STACKS
+static stack_record **ids[DEPOT_MAX_STACKS / DEPOT_BLOCK_STACKS];
+static uint32_t next_id = 1;
+
+//Chunk records are carved from
+static char *chunk_next;
+static char *chunk_end;
+
+static size_t mapped_bytes;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+//Bounds of the calling thread's stack, found on its first unwind. Frames
+//outside them are never read
+static __thread char *stack_lo;
+static __thread char *stack_hi;
+static __thread int bounds_known;
+
+//Find the calling thread's stack bounds, leaving them empty if unknown
+static void bounds_init()
+{
+	pthread_attr_t attr;
+	void *addr;
+	size_t size;
+
+	bounds_known = 1;
+
+	if (pthread_getattr_np(pthread_self(), &attr) != 0)
+	{
+		return;
+	}
+
+	if (pthread_attr_getstack(&attr, &addr, &size) == 0)
+	{
+		stack_lo = addr;
+		stack_hi = (char *)addr + size;
+	}
+	pthread_attr_destroy(&attr);
+}
+
+//Follow the frame pointer chain from frame, the frame address of the
+//allocating function, storing up to max return addresses in frames
+//starting with the allocating function's own. The walk stops at a frame
+//that is outside the thread's stack or not above the last one, so code
+//built without frame pointers only shortens the stack
+//Return the number of frames stored
+int stack_unwind(void *frame, void **frames, int max)
+{
+	void **fp = frame;
+	int depth = 0;
+
+	if (!bounds_known)
+	{
+		bounds_init();
+	}
+
+	while (depth < max && (char *)fp >= stack_lo && (char *)(fp + 2) <= stack_hi && ((uintptr_t)fp & (sizeof(void *) - 1)) == 0)
+	{
+		void **next = fp[0];
+
+		if (fp[1] == NULL)
+		{
+			break;
+		}
+		frames[depth++] = fp[1];
+
+		//Callers' frames lie above their callees'
+		if (next <= fp)
+		{
+			break;
+		}
+		fp = next;
+	}
+
+	return depth;
+}
+
+//Hash a stack's frames
+static uint32_t stack_hash(void *const *frames, int depth)
+{
+	uint64_t hash = (uint64_t)depth;
+
+	for (int i = 0; i < depth; i++)
+	{
+		hash = (hash ^ (uintptr_t)frames[i]) * 0x9E3779B97F4A7C15ULL;
+		hash ^= hash >> 29;
+	}
+
+	return (uint32_t)(hash >> 32);
+}
+
+//Return the record of the stack in the chain starting at first, or NULL
+static stack_record *chain_find(stack_record *first, uint32_t hash, void *const *frames, int depth)
+{
+	for (stack_record *rec = first; rec != NULL; rec = rec->next)
+	{
+		if (rec->hash == hash && rec->depth == (uint32_t)depth && memcmp(rec->frames, frames, depth * sizeof(void *)) == 0)
+		{
+			return rec;
+		}
+	}
+
+	return NULL;
+}
+
+//Map zero filled memory, counting it. Return NULL if it failed
+static void *depot_map(size_t bytes)
+{
+	void *mem = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (mem == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	__atomic_fetch_add(&mapped_bytes, bytes, __ATOMIC_RELAXED);
+	return mem;
+}
+
+//Carve a record with room for depth frames and give it the next id
+//Must be called with the lock held. Return NULL if the depot is full or
+//out of memory
+static stack_record *record_new(int depth)
+{
+	size_t bytes = (sizeof(stack_record) + depth * sizeof(void *) + 15) & ~(size_t)15;
+	stack_record **block;
+	stack_record *rec;
+
+	if (next_id >= DEPOT_MAX_STACKS)
+	{
+		return NULL;
+	}
+
+	block = ids[next_id / DEPOT_BLOCK_STACKS];
+	if (block == NULL)
+	{
+		block = depot_map(DEPOT_BLOCK_STACKS * sizeof(stack_record *));
+		if (block == NULL)
+		{
+			return NULL;
+		}
+		__atomic_store_n(&ids[next_id / DEPOT_BLOCK_STACKS], block, __ATOMIC_RELEASE);
+	}
+
+	if ((size_t)(chunk_end - chunk_next) < bytes)
+	{
+		chunk_next = depot_map(DEPOT_CHUNK_BYTES);
+		if (chunk_next == NULL)
+		{
+			chunk_end = NULL;
+			return NULL;
+		}
+		chunk_end = chunk_next + DEPOT_CHUNK_BYTES;
+	}
+
+	rec = (stack_record *)chunk_next;
+	chunk_next += bytes;
+
+	rec->id = next_id;
+	__atomic_store_n(&block[next_id % DEPOT_BLOCK_STACKS], rec, __ATOMIC_RELEASE);
+	__atomic_store_n(&next_id, next_id + 1, __ATOMIC_RELAXED);
+
+	return rec;
+}
+
+//Return the id of the stack of depth frames, storing it the first time
+//Return 0 for an empty stack, or if the depot is full or out of memory
+uint32_t depot_put(void *const *frames, int depth)
+{
+	uint32_t hash;
+	stack_record **bucket, *rec;
+
+	if (depth <= 0)
+	{
+		return 0;
+	}
+
+	hash = stack_hash(frames, depth);
+	bucket = &buckets[hash & ((1 << DEPOT_BUCKET_BITS) - 1)];
+
+	rec = chain_find(__atomic_load_n(bucket, __ATOMIC_ACQUIRE), hash, frames, depth);
+	if (rec != NULL)
+	{
+		return rec->id;
+	}
+
+	pthread_mutex_lock(&lock);
+
+	//Another thread may have stored the stack meanwhile
+	rec = chain_find(*bucket, hash, frames, depth);
+	if (rec == NULL && (rec = record_new(depth)) != NULL)
+	{
+		rec->hash = hash;
+		rec->depth = depth;
+		memcpy(rec->frames, frames, depth * sizeof(void *));
+		rec->next = *bucket;
+
+		//The record is complete before readers can find it
+		__atomic_store_n(bucket, rec, __ATOMIC_RELEASE);
+	}
+
+	pthread_mutex_unlock(&lock);
+
+	return (rec == NULL) ? 0 : rec->id;
+}
+
+//Return the frames of the stack with the given id, setting depth to their
+//number. Id 0, or one never handed out, is an empty stack
+void *const *depot_get(uint32_t id, int *depth)
+{
+	stack_record **block;
+	stack_record *rec = NULL;
+
+	if (id < DEPOT_MAX_STACKS)
+	{
+		block = __atomic_load_n(&ids[id / DEPOT_BLOCK_STACKS], __ATOMIC_ACQUIRE);
+		if (block != NULL)
+		{
+			rec = __atomic_load_n(&block[id % DEPOT_BLOCK_STACKS], __ATOMIC_ACQUIRE);
+		}
+	}
+
+	if (rec == NULL)
+	{
+		*depth = 0;
+		return NULL;
+	}
+
+	*depth = rec->depth;
+	return rec->frames;
+}
+
+//Return the number of stacks stored
+size_t depot_count()
+{
+	return __atomic_load_n(&next_id, __ATOMIC_RELAXED) - 1;
+}
+
+//Return the bytes mapped for the depot
+size_t depot_mapped_bytes()
+{
+	return __atomic_load_n(&mapped_bytes, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,38 @@
+#ifndef STACK_DEPOT_H
+#define STACK_DEPOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+//Environment variable holding the frames captured per allocation
+#define STACK_DEPTH_ENV "MALLOC537_STACK_DEPTH"
+
+//Frames captured unless MALLOC537_STACK_DEPTH says otherwise, and the most
+//that can be asked for
+#define STACK_DEFAULT_DEPTH 8
+#define STACK_MAX_DEPTH 32
+
+//Hash buckets of the depot, a power of two
+#define DEPOT_BUCKET_BITS 14
+
+//Stacks the depot holds at most. Once it is full new stacks get id 0
+#define DEPOT_MAX_STACKS (1 << 20)
+
+//Ids per block of the id table, blocks are mapped as ids are handed out
+#define DEPOT_BLOCK_STACKS 4096
+
+//Bytes mapped at a time for stack records
+#define DEPOT_CHUNK_BYTES (1 << 20)
+
+//Stack Depot Functions
+int stack_unwind(void *frame, void **frames, int max);
+
+uint32_t depot_put(void *const *frames, int depth);
+
+void *const *depot_get(uint32_t id, int *depth);
+
+size_t depot_count();
+
+size_t depot_mapped_bytes();
+
+#endif
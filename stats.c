@@ -0,0 +1,195 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include "pool.h"
+#include "stats.h"
+
+//Heap statistics kept per thread. Each thread only writes its own record,
+//so an update is a plain add with no shared cache line; a read sums the
+//records of every thread. Records of exited threads are reused, counts and
+//all, by new threads. Live bytes are folded into a shared total every
+//STATS_FLUSH_BYTES. Each thread also keeps the most live bytes it has seen,
+//the shared total plus its own unfolded bytes, which a read folds into the
+//peak; with one thread that is the exact peak
+
+//One thread's counts. pending is the live bytes gained (or lost, when
+//negative) since the last fold; live_blocks may also go negative, as a
+//block can be freed by another thread than the one that allocated it.
+//high is the most live bytes the thread has seen
+typedef struct stats_thread
+{
+	long pending;
+	size_t high;
+	long live_blocks;
+	size_t allocs;
+	size_t frees;
+	size_t reallocs;
+	int in_use;
+	struct stats_thread *next;
+
+} stats_thread;
+
+//Every thread record ever made, drawn from a pool so the counters stay
+//out of the heap they count
+static stats_thread *threads;
+static pool thread_pool = POOL_INITIALIZER(sizeof(stats_thread));
+
+//Live bytes folded in by the threads, and the most there have been
+static long folded;
+static size_t peak;
+
+static __thread stats_thread *self;
+static pthread_key_t self_key;
+static pthread_once_t self_once = PTHREAD_ONCE_INIT;
+
+//Leave a record for the next new thread when its thread exits
+static void self_release(void *arg)
+{
+	stats_thread *t = arg;
+
+	__atomic_store_n(&t->in_use, 0, __ATOMIC_RELEASE);
+	self = NULL;
+}
+
+static void self_key_create()
+{
+	pthread_key_create(&self_key, self_release);
+}
+
+//Return the calling thread's record, adopting an unused one or registering
+//a new one the first time. Exits if out of memory
+static stats_thread *self_get()
+{
+	stats_thread *t;
+
+	if (self != NULL)
+	{
+		return self;
+	}
+
+	pthread_once(&self_once, self_key_create);
+
+	for (t = __atomic_load_n(&threads, __ATOMIC_ACQUIRE); t != NULL; t = t->next)
+	{
+		int unused = 0;
+
+		if (__atomic_compare_exchange_n(&t->in_use, &unused, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+		{
+			break;
+		}
+	}
+
+	if (t == NULL)
+	{
+		t = pool_calloc(&thread_pool);
+		if (t == NULL)
+		{
+			fprintf(stderr, "Malloc failed");
+			exit(EXIT_FAILURE);
+		}
+		t->in_use = 1;
+
+		t->next = __atomic_load_n(&threads, __ATOMIC_RELAXED);
+		while (!__atomic_compare_exchange_n(&threads, &t->next, t, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+		{
+		}
+	}
+
+	self = t;
+	pthread_setspecific(self_key, t);
+
+	return t;
+}
+
+//Raise the peak to live if it is higher
+static void peak_raise(size_t live)
+{
+	size_t seen = __atomic_load_n(&peak, __ATOMIC_RELAXED);
+
+	while (live > seen && !__atomic_compare_exchange_n(&peak, &seen, live, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+	{
+	}
+}
+
+//Add bytes to the thread's live bytes, raising its high mark if they rise
+//above it, and folding them into the shared total once enough have built up
+static void live_add(stats_thread *t, long bytes)
+{
+	long pending = t->pending + bytes;
+	long seen = __atomic_load_n(&folded, __ATOMIC_RELAXED) + pending;
+
+	if (seen > 0 && (size_t)seen > t->high)
+	{
+		__atomic_store_n(&t->high, (size_t)seen, __ATOMIC_RELAXED);
+	}
+
+	if (pending > STATS_FLUSH_BYTES || pending < -STATS_FLUSH_BYTES)
+	{
+		long live = __atomic_add_fetch(&folded, pending, __ATOMIC_RELAXED);
+
+		if (live > 0)
+		{
+			peak_raise((size_t)live);
+		}
+		pending = 0;
+	}
+
+	__atomic_store_n(&t->pending, pending, __ATOMIC_RELAXED);
+}
+
+//Count blocks new blocks totalling bytes
+void stats_alloc(size_t bytes, size_t blocks)
+{
+	stats_thread *t = self_get();
+
+	__atomic_store_n(&t->allocs, t->allocs + blocks, __ATOMIC_RELAXED);
+	__atomic_store_n(&t->live_blocks, t->live_blocks + (long)blocks, __ATOMIC_RELAXED);
+	live_add(t, (long)bytes);
+}
+
+//Count blocks freed blocks totalling bytes
+void stats_free(size_t bytes, size_t blocks)
+{
+	stats_thread *t = self_get();
+
+	__atomic_store_n(&t->frees, t->frees + blocks, __ATOMIC_RELAXED);
+	__atomic_store_n(&t->live_blocks, t->live_blocks - (long)blocks, __ATOMIC_RELAXED);
+	live_add(t, -(long)bytes);
+}
+
+//Count a block resized from old_bytes to new_bytes
+void stats_realloc(size_t old_bytes, size_t new_bytes)
+{
+	stats_thread *t = self_get();
+
+	__atomic_store_n(&t->reallocs, t->reallocs + 1, __ATOMIC_RELAXED);
+	live_add(t, (long)new_bytes - (long)old_bytes);
+}
+
+//Sum every thread's counts into out. The sums are not taken at one
+//instant, so counts changing meanwhile may be off by the changes
+void stats_read(heap_stats *out)
+{
+	long live = __atomic_load_n(&folded, __ATOMIC_RELAXED);
+	long blocks = 0;
+
+	memset(out, 0, sizeof(heap_stats));
+
+	for (stats_thread *t = __atomic_load_n(&threads, __ATOMIC_ACQUIRE); t != NULL; t = t->next)
+	{
+		live += __atomic_load_n(&t->pending, __ATOMIC_RELAXED);
+		blocks += __atomic_load_n(&t->live_blocks, __ATOMIC_RELAXED);
+		out->allocs += __atomic_load_n(&t->allocs, __ATOMIC_RELAXED);
+		out->frees += __atomic_load_n(&t->frees, __ATOMIC_RELAXED);
+		out->reallocs += __atomic_load_n(&t->reallocs, __ATOMIC_RELAXED);
+		peak_raise(__atomic_load_n(&t->high, __ATOMIC_RELAXED));
+	}
+
+	out->live_bytes = (live > 0) ? (size_t)live : 0;
+	out->live_blocks = (blocks > 0) ? (size_t)blocks : 0;
+
+	//The live bytes seen now may be above any folded total
+	peak_raise(out->live_bytes);
+	out->peak_bytes = __atomic_load_n(&peak, __ATOMIC_RELAXED);
+}
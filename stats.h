@@ -0,0 +1,32 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stddef.h>
+
+//Live bytes a thread may gain or lose before it folds them into the shared
+//total. With several threads, the peak may be off by this much per thread
+//besides the one that reached it
+#define STATS_FLUSH_BYTES (64 * 1024)
+
+//Totals over every thread
+typedef struct heap_stats
+{
+	size_t live_bytes;
+	size_t live_blocks;
+	size_t peak_bytes;
+	size_t allocs;
+	size_t frees;
+	size_t reallocs;
+
+} heap_stats;
+
+//Statistics Functions
+void stats_alloc(size_t bytes, size_t blocks);
+
+void stats_free(size_t bytes, size_t blocks);
+
+void stats_realloc(size_t old_bytes, size_t new_bytes);
+
+void stats_read(heap_stats *out);
+
+#endif
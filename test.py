@@ -1,12 +1,18 @@
+import os
 import subprocess
 import time
 
 
-argList = ["simple_testcase1","simple_testcase2","simple_testcase3","simple_testcase4","simple_testcase5","error_testcase1","error_testcase2","error_testcase3","error_testcase4","advanced_testcase1","advanced_testcase2","advanced_testcase3","advanced_testcase4"]
+argList = ["simple_testcase1","simple_testcase2","simple_testcase3","simple_testcase4","simple_testcase5","simple_testcase6","simple_testcase7","simple_testcase8","simple_testcase9","simple_testcase10","simple_testcase11","simple_testcase12","simple_testcase13","simple_testcase14","unit_tests/finger_test","unit_tests/poison_test","unit_tests/site_test","unit_tests/depot_test","unit_tests/sampler_test","error_testcase1","error_testcase2","error_testcase3","error_testcase4","error_testcase5","error_testcase6","advanced_testcase1","advanced_testcase2","advanced_testcase3","advanced_testcase4","advanced_testcase5","advanced_testcase6"]
+
+# Tests that cannot pass when MALLOC537_ALLOCATOR=arena is set, and are skipped then:
+# simple_testcase1 hands a malloc537 block to libc free(), and arena blocks never come from libc
+# error_testcase5 needs redzones and error_testcase6 the quarantine, which the arena allocator does not support
+arenaSkip = ["simple_testcase1","error_testcase5","error_testcase6"]
 
 # simplearglist = ["simple_testcase1","simple_testcase2","simple_testcase3","simple_testcase4","simple_testcase5"]
 # errorarglist = ["error_testcase1","error_testcase2","error_testcase3","error_testcase4"]
-# advancedarglist = ["advanced_testcase1","advanced_testcase2","advanced_testcase3","advanced_testcase4"]
+# advancedarglist = ["advanced_testcase1","advanced_testcase2","advanced_testcase3","advanced_testcase4","advanced_testcase5","advanced_testcase6"]
 #ar = "NAME=simple_testcase2 "
 
 #print 'running make'
@@ -16,6 +22,9 @@ for args in argList:
 	cmd = 'make '# NAME='+ args 
 	cmd = cmd+" "+"NAME="+args
 	print(args)
+	if os.environ.get("MALLOC537_ALLOCATOR") == "arena" and args in arenaSkip:
+		print("Skipped under the arena allocator")
+		continue
 	if args != "advanced_testcase1" or args != "advanced_testcase2":
 		raw_input("")
 		subprocess.call(cmd,shell =True)
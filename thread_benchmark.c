@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+#include "537malloc.h"
+
+#define MAX_THREADS 8
+#define OPS 200000
+#define LIVE 64
+
+//Blocks handed from each thread to the next, freed by the receiver
+static void *handoff[MAX_THREADS];
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//Each thread allocates, checks and frees its own blocks, and frees one
+//block in every sixteen on the next thread
+static void *worker(void *arg) {
+	long id = ((long *)arg)[0];
+	long threads = ((long *)arg)[1];
+	static __thread char *live[LIVE];
+	static __thread size_t sizes[LIVE];
+	unsigned int seed = id * 7919 + 1;
+	int i;
+
+	for(i = 0; i < OPS; i++) {
+		int slot = i % LIVE;
+		size_t size;
+		char *ptr;
+
+		if(live[slot] != NULL) {
+			memcheck537(live[slot] + sizes[slot] / 2, sizes[slot] - sizes[slot] / 2);
+			free537(live[slot]);
+		}
+
+		seed = seed * 1103515245 + 12345;
+		size = 1 + (seed >> 16) % 512;
+		ptr = malloc537(size);
+		ptr[0] = ptr[size - 1] = (char)id;
+
+		if(i % 16 == 0) {
+			ptr = __atomic_exchange_n(&handoff[(id + 1) % threads], ptr, __ATOMIC_ACQ_REL);
+			if(ptr != NULL) {
+				free537(ptr);
+			}
+			live[slot] = NULL;
+			continue;
+		}
+
+		live[slot] = ptr;
+		sizes[slot] = size;
+	}
+
+	for(i = 0; i < LIVE; i++) {
+		if(live[i] != NULL) {
+			free537(live[i]);
+			live[i] = NULL;
+		}
+	}
+
+	return NULL;
+}
+
+//Times a fixed per-thread workload with 1, 2, 4 and 8 threads and prints
+//the throughput and the speedup over one thread. Only meaningful on a host
+//with at least as many cores as threads
+int main() {
+	pthread_t tid[MAX_THREADS];
+	long args[MAX_THREADS][2];
+	double base = 0;
+	long threads;
+	int i;
+
+	for(threads = 1; threads <= MAX_THREADS; threads *= 2) {
+		double start = now(), elapsed;
+
+		for(i = 0; i < threads; i++) {
+			args[i][0] = i;
+			args[i][1] = threads;
+			pthread_create(&tid[i], NULL, worker, args[i]);
+		}
+		for(i = 0; i < threads; i++) {
+			pthread_join(tid[i], NULL);
+		}
+		for(i = 0; i < threads; i++) {
+			if(handoff[i] != NULL) {
+				free537(handoff[i]);
+				handoff[i] = NULL;
+			}
+		}
+
+		elapsed = now() - start;
+		if(threads == 1) {
+			base = OPS / elapsed;
+		}
+		printf("Threads: %ld Ops/sec: %.0f Speedup: %.2f\n", threads, threads * OPS / elapsed, threads * OPS / elapsed / base);
+	}
+}
@@ -0,0 +1,88 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "537malloc.h"
+#include "site_table.h"
+#include "stack_depot.h"
+
+//One place that allocates, reached from two callers
+__attribute__((noinline)) static void *leaf(size_t size) {
+	return malloc537(size);
+}
+
+__attribute__((noinline)) static void *caller_a(size_t size) {
+	return leaf(size);
+}
+
+__attribute__((noinline)) static void *caller_b(size_t size) {
+	return leaf(size);
+}
+
+//Return the stack of the single site that made allocs allocations, or
+//NULL if there is not exactly one. Set depth to its frames
+static void *const *stack_of(size_t allocs, int *depth) {
+	size_t n;
+	site **sites = site_snapshot(&n);
+	void *const *frames = NULL;
+	int matches = 0;
+
+	for(size_t i = 0; i < n; i++) {
+		if(sites[i]->num_allocations == allocs) {
+			frames = depot_get(sites[i]->stack, depth);
+			matches++;
+		}
+	}
+	site_snapshot_free(sites);
+
+	return matches == 1 ? frames : NULL;
+}
+
+//Checks that the depot hands one id to each distinct stack, and that
+//allocations from the same place reached through different callers are
+//credited to different sites
+int main() {
+	void *frames1[3] = {(void *)0x1000, (void *)0x2000, (void *)0x3000};
+	void *frames2[3] = {(void *)0x1000, (void *)0x2000, (void *)0x4000};
+	void *const *stack_a, *const *stack_b, *const *stored;
+	int depth, depth_a, depth_b, i;
+	uint32_t id1;
+
+	//Callers are only told apart with more than one frame, and every
+	//allocation is recorded
+	setenv(STACK_DEPTH_ENV, "8", 1);
+	malloc537_sample_interval(0);
+
+	id1 = depot_put(frames1, 3);
+	//The same stack is stored once, a stack differing in one frame is not
+	if(id1 == 0 || depot_put(frames1, 3) != id1 || depot_put(frames2, 3) == id1 || depot_put(frames1, 2) == id1) {
+		printf("Depot ids do not match their stacks\n");
+		return 1;
+	}
+
+	stored = depot_get(id1, &depth);
+	if(depth != 3 || stored[0] != frames1[0] || stored[2] != frames1[2]) {
+		printf("Depot returned a different stack\n");
+		return 1;
+	}
+
+	for(i = 0; i < 4; i++) {
+		free537(caller_a(50));
+	}
+	for(i = 0; i < 6; i++) {
+		free537(caller_b(50));
+	}
+
+	stack_a = stack_of(4, &depth_a);
+	stack_b = stack_of(6, &depth_b);
+	if(stack_a == NULL || stack_b == NULL || depth_a < 2 || depth_b < 2) {
+		printf("Callers were not credited to sites of their own\n");
+		return 1;
+	}
+
+	if(stack_a[0] != stack_b[0] || stack_a[1] == stack_b[1]) {
+		printf("Stacks should share the allocating frame and differ in the caller\n");
+		return 1;
+	}
+
+	printf("If this prints, you get points!\n");
+	return 0;
+}
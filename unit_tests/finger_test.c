@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include "range_tree.h"
+
+//Addresses for the records, never dereferenced
+static char region[1024];
+
+//Return the address of the record found by tree_find_GLT, or NULL
+static void *glt(tree *tree, int offset) {
+	node *found = tree_find_GLT(tree, region + offset);
+
+	return found == NULL ? NULL : found->addr;
+}
+
+//Check that a predecessor query cached by the thread is not reused once an
+//insert or an erase changes the tree, with every index backend
+static int check_backend(const char *name) {
+	tree *tree = tree_create_backend(name);
+
+	node_insert(tree, region + 100, 10);
+	node_insert(tree, region + 300, 10);
+
+	//Caches the gap between 100 and 300
+	if(glt(tree, 200) != region + 100) {
+		printf("%s: wrong predecessor of 200\n", name);
+		return 1;
+	}
+
+	//A node inserted inside the cached gap
+	node_insert(tree, region + 200, 10);
+	if(glt(tree, 250) != region + 200) {
+		printf("%s: predecessor of 250 missed an insert\n", name);
+		return 1;
+	}
+
+	//The cached predecessor erased
+	tree_erase(tree, region + 200);
+	if(glt(tree, 250) != region + 100) {
+		printf("%s: predecessor of 250 missed an erase\n", name);
+		return 1;
+	}
+	tree_erase(tree, region + 100);
+	if(glt(tree, 250) != NULL) {
+		printf("%s: predecessor of 250 missed a second erase\n", name);
+		return 1;
+	}
+
+	tree_delete(tree);
+
+	//A new tree, perhaps in the old one's memory, starts uncached
+	tree = tree_create_backend(name);
+	node_insert(tree, region + 500, 10);
+	if(glt(tree, 250) != NULL || glt(tree, 600) != region + 500) {
+		printf("%s: new tree answered from an old query\n", name);
+		return 1;
+	}
+	tree_delete(tree);
+
+	return 0;
+}
+
+int main() {
+	if(check_backend("rb") || check_backend("jsw") || check_backend("bptree")) {
+		return 1;
+	}
+
+	printf("If this prints, you get points!\n");
+
+	return 0;
+}
@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "poison.h"
+
+#define SPAN 320
+
+//Check the kernels in use against a byte at a time loop, over every
+//alignment and length up to a few vectors. Return nonzero on a mismatch
+static int check_kernel() {
+	unsigned char buf[SPAN + 128];
+	size_t offset, length, i;
+
+	for(offset = 0; offset < 64; offset++) {
+		for(length = 0; length <= SPAN; length++) {
+			memset(buf, 0x11, sizeof(buf));
+			poison_fill(buf + offset, length, 0xA5);
+
+			for(i = 0; i < sizeof(buf); i++) {
+				unsigned char want = (i >= offset && i < offset + length) ? 0xA5 : 0x11;
+
+				if(buf[i] != want) {
+					printf("%s: fill of %zu bytes at offset %zu wrote byte %zu\n", poison_kernel(), length, offset, i);
+					return 1;
+				}
+			}
+
+			if(!poison_intact(buf + offset, length, 0xA5)) {
+				printf("%s: intact %zu bytes at offset %zu reported damaged\n", poison_kernel(), length, offset);
+				return 1;
+			}
+
+			//A single changed byte is found wherever it is
+			for(i = 0; i < length; i++) {
+				buf[offset + i] ^= 0x40;
+				if(poison_intact(buf + offset, length, 0xA5)) {
+					printf("%s: byte %zu of %zu at offset %zu changed unnoticed\n", poison_kernel(), i, length, offset);
+					return 1;
+				}
+				buf[offset + i] ^= 0x40;
+			}
+		}
+	}
+
+	return 0;
+}
+
+//Runs the scalar and vector poison kernels through the same checks. The
+//kernels are chosen once per process, so each is run in a child
+int main() {
+	const char *kernels[] = {"scalar", "sse2", "avx2"};
+	int i, status;
+
+	for(i = 0; i < 3; i++) {
+		pid_t pid = fork();
+
+		if(pid == 0) {
+			setenv(POISON_KERNEL_ENV, kernels[i], 1);
+			exit(check_kernel());
+		}
+
+		if(pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			printf("Poison kernel %s failed\n", kernels[i]);
+			return 1;
+		}
+	}
+
+	printf("If this prints, you get points!\n");
+	return 0;
+}
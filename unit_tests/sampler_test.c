@@ -0,0 +1,80 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "537malloc.h"
+#include "site_table.h"
+
+#define SMALL_ALLOCS 400000
+#define LARGE_ALLOCS 2000
+
+__attribute__((noinline)) static void *small_site(size_t size) {
+	return malloc537(size);
+}
+
+__attribute__((noinline)) static void *large_site(size_t size) {
+	return malloc537(size);
+}
+
+//Return nonzero, printing why, unless estimate is within a quarter of truth
+static int check_estimate(const char *what, size_t estimate, size_t truth) {
+	if(estimate < truth - truth / 4 || estimate > truth + truth / 4) {
+		printf("%s: estimated %zu, the truth is %zu\n", what, estimate, truth);
+		return 1;
+	}
+
+	return 0;
+}
+
+//Return nonzero, printing why, unless the one site whose allocations
+//average below 1KB (small) or above it has estimates near allocs
+//allocations of bytes bytes
+static int check_site(const char *name, int small, size_t allocs, size_t bytes) {
+	size_t n;
+	site **sites = site_snapshot(&n);
+	site *found = NULL;
+	int matches = 0;
+
+	for(size_t i = 0; i < n; i++) {
+		if(sites[i]->num_allocations > 0 && (sites[i]->allocated_bytes / sites[i]->num_allocations < 1024) == small) {
+			found = sites[i];
+			matches++;
+		}
+	}
+	site_snapshot_free(sites);
+
+	if(matches != 1) {
+		printf("%s: %d sites found\n", name, matches);
+		return 1;
+	}
+
+	return check_estimate(name, found->num_allocations, allocs) || check_estimate(name, found->allocated_bytes, bytes);
+}
+
+//Allocates many small blocks from one site and fewer large ones from
+//another at a 64KB sampling interval, and checks the weighted counts of
+//both sites against the true counts. Small blocks are rarely sampled and
+//weigh a lot, large ones are nearly always sampled and weigh about one
+int main() {
+	size_t small_bytes = 0, large_bytes = 0, size;
+	int i;
+
+	malloc537_sample_interval(64 * 1024);
+
+	for(i = 0; i < SMALL_ALLOCS; i++) {
+		size = 40 + i % 80;
+		free537(small_site(size));
+		small_bytes += size;
+	}
+	for(i = 0; i < LARGE_ALLOCS; i++) {
+		size = 256 * 1024 + i;
+		free537(large_site(size));
+		large_bytes += size;
+	}
+
+	if(check_site("Small allocations", 1, SMALL_ALLOCS, small_bytes) ||
+	   check_site("Large allocations", 0, LARGE_ALLOCS, large_bytes)) {
+		return 1;
+	}
+
+	printf("If this prints, you get points!\n");
+	return 0;
+}
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "537malloc.h"
+#include "site_table.h"
+#include "stack_depot.h"
+
+//Each function below is one call site of malloc537
+__attribute__((noinline)) static void *site_a(size_t size) {
+	return malloc537(size);
+}
+
+__attribute__((noinline)) static void *site_b(size_t size) {
+	return malloc537(size);
+}
+
+__attribute__((noinline)) static void *site_c(size_t size) {
+	return malloc537(size);
+}
+
+//Return nonzero, printing why, unless exactly one site made allocs
+//allocations, of bytes bytes in all, with live_blocks blocks of live_bytes
+//bytes still allocated. Set ret to the address its allocations return to
+static int check_site(const char *name, size_t allocs, size_t bytes, size_t live_blocks, size_t live_bytes, void **ret) {
+	size_t n;
+	site **sites = site_snapshot(&n);
+	site *found = NULL;
+	int matches = 0, depth;
+
+	for(size_t i = 0; i < n; i++) {
+		if(sites[i]->num_allocations == allocs) {
+			found = sites[i];
+			matches++;
+		}
+	}
+	site_snapshot_free(sites);
+
+	if(matches != 1) {
+		printf("%s: %d sites made %zu allocations\n", name, matches, allocs);
+		return 1;
+	}
+
+	if(found->allocated_bytes != bytes || found->live_blocks != live_blocks || found->live_bytes != live_bytes) {
+		printf("%s: %zu bytes allocated, %zu blocks of %zu bytes live\n", name,
+			found->allocated_bytes, found->live_blocks, found->live_bytes);
+		return 1;
+	}
+
+	*ret = depot_get(found->stack, &depth)[0];
+	return 0;
+}
+
+//Allocates from three call sites with different counts and sizes, frees
+//some of the blocks, and checks each site's totals and live counts
+int main() {
+	void *a[3], *b[5], *c[7];
+	void *ret[3];
+	int i;
+
+	//Slab objects of the arena allocator are not counted as live
+	if(malloc537_allocator("libc") != 0) {
+		printf("Could not choose the libc allocator\n");
+		return 1;
+	}
+
+	for(i = 0; i < 3; i++) {
+		a[i] = site_a(100);
+	}
+	for(i = 0; i < 5; i++) {
+		b[i] = site_b(200 + i);
+	}
+	for(i = 0; i < 7; i++) {
+		c[i] = site_c(30);
+	}
+
+	free537(a[0]);
+	for(i = 0; i < 5; i++) {
+		free537(b[i]);
+	}
+
+	if(check_site("site_a", 3, 300, 2, 200, &ret[0]) ||
+	   check_site("site_b", 5, 1010, 0, 0, &ret[1]) ||
+	   check_site("site_c", 7, 210, 7, 210, &ret[2])) {
+		return 1;
+	}
+
+	if(ret[0] == ret[1] || ret[1] == ret[2] || ret[0] == ret[2]) {
+		printf("Different call sites share a return address\n");
+		return 1;
+	}
+
+	for(i = 1; i < 3; i++) {
+		free537(a[i]);
+	}
+	for(i = 0; i < 7; i++) {
+		free537(c[i]);
+	}
+
+	printf("If this prints, you get points!\n");
+	return 0;
+}